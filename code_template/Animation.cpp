@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "tinyxml2.h"
+#include "Animation.h"
+#include "TextParser.h"
+
+using namespace tinyxml2;
+using namespace std;
+
+static bool compareCameraKeys(const CameraKey &a, const CameraKey &b)
+{
+    return a.frame < b.frame;
+}
+
+static bool compareTransformationKeys(const TransformationKey &a, const TransformationKey &b)
+{
+    if (a.type != b.type)
+        return a.type < b.type;
+    if (a.id != b.id)
+        return a.id < b.id;
+    return a.frame < b.frame;
+}
+
+/*
+    Reads count numbers of the attribute, returns false when it is missing or short.
+*/
+static bool parseValues(XMLElement *element, const char *name, double *values, int count)
+{
+    const char *p = element->Attribute(name);
+    if (p == NULL)
+        return false;
+
+    for (int i = 0; i < count; i++)
+    {
+        const char *next = parseDouble(p, values[i]);
+        if (next == p)
+            return false;
+        p = next;
+    }
+    return true;
+}
+
+static bool parseVec3(XMLElement *element, const char *name, Vec3 &vector)
+{
+    double values[3];
+    if (!parseValues(element, name, values, 3))
+        return false;
+
+    vector = Vec3(values[0], values[1], values[2]);
+    return true;
+}
+
+static double interpolate(double a, double b, double t)
+{
+    return a + (b - a) * t;
+}
+
+static Vec3 interpolate(Vec3 &a, Vec3 &b, double t)
+{
+    return Vec3(interpolate(a.x, b.x, t), interpolate(a.y, b.y, t), interpolate(a.z, b.z, t));
+}
+
+Animation::Animation()
+{
+    this->frameCount = 0;
+    this->cameraId = 0;
+    this->baseCamera = NULL;
+}
+
+bool Animation::load(const char *path, Scene *scene)
+{
+    XMLDocument document;
+    if (document.LoadFile(path) != XML_SUCCESS || document.FirstChildElement("Animation") == NULL)
+    {
+        cerr << "Could not read the animation " << path << endl;
+        return false;
+    }
+    XMLElement *root = document.FirstChildElement("Animation");
+
+    if (root->QueryIntAttribute("frames", &this->frameCount) != XML_SUCCESS || this->frameCount <= 0)
+    {
+        cerr << "The animation needs a positive frames count" << endl;
+        return false;
+    }
+
+    this->baseCamera = scene->cameras.empty() ? NULL : scene->cameras[0];
+    if (root->QueryIntAttribute("camera", &this->cameraId) == XML_SUCCESS)
+    {
+        this->baseCamera = NULL;
+        for (int i = 0; i < scene->cameras.size(); i++)
+        {
+            if (scene->cameras[i]->cameraId == this->cameraId)
+                this->baseCamera = scene->cameras[i];
+        }
+    }
+    if (this->baseCamera == NULL)
+    {
+        cerr << "The scene has no camera " << this->cameraId << " to animate" << endl;
+        return false;
+    }
+    this->cameraId = this->baseCamera->cameraId;
+
+    const char *output = root->Attribute("output");
+    if (output == NULL)
+    {
+        string name = this->baseCamera->outputFilename;
+        size_t dot = name.find_last_of('.');
+        size_t slash = name.find_last_of("/\\");
+        if (dot == string::npos || (slash != string::npos && dot < slash))
+            dot = name.size();
+        this->outputPattern = name.substr(0, dot) + "_%04d" + name.substr(dot);
+    }
+    else
+    {
+        this->outputPattern = output;
+    }
+
+    // exactly one %d, zero padding allowed, and no other conversion
+    const char *percent = strchr(this->outputPattern.c_str(), '%');
+    size_t digits = percent == NULL ? 0 : strspn(percent + 1, "0123456789");
+    if (percent == NULL || percent[1 + digits] != 'd' || strchr(percent + 2 + digits, '%') != NULL)
+    {
+        cerr << "The animation output " << this->outputPattern << " needs one %d for the frame number" << endl;
+        return false;
+    }
+
+    for (XMLElement *element = root->FirstChildElement(); element != NULL; element = element->NextSiblingElement())
+    {
+        if (strcmp(element->Name(), "CameraKey") == 0)
+        {
+            CameraKey key;
+            if (element->QueryIntAttribute("frame", &key.frame) != XML_SUCCESS ||
+                !parseVec3(element, "position", key.position) || !parseVec3(element, "gaze", key.gaze) ||
+                !parseVec3(element, "up", key.up))
+            {
+                cerr << "A CameraKey needs frame, position, gaze and up attributes" << endl;
+                return false;
+            }
+            this->cameraKeys.push_back(key);
+        }
+        else if (strcmp(element->Name(), "TransformationKey") == 0)
+        {
+            TransformationKey key;
+            const char *type = element->Attribute("type");
+            int count = type != NULL && strcmp(type, "rotation") == 0 ? 4 : 3;
+            int size = 0;
+
+            key.type = type == NULL ? 0 : type[0];
+            key.values[3] = 0;
+            if (type == NULL)
+                size = 0;
+            else if (strcmp(type, "translation") == 0)
+                size = scene->translations.size();
+            else if (strcmp(type, "scaling") == 0)
+                size = scene->scalings.size();
+            else if (strcmp(type, "rotation") == 0)
+                size = scene->rotations.size();
+
+            if (element->QueryIntAttribute("frame", &key.frame) != XML_SUCCESS ||
+                element->QueryIntAttribute("id", &key.id) != XML_SUCCESS || size == 0 ||
+                !parseValues(element, "value", key.values, count))
+            {
+                cerr << "A TransformationKey needs frame, type (translation, scaling or rotation), id and value attributes" << endl;
+                return false;
+            }
+            if (key.id < 1 || key.id > size)
+            {
+                cerr << "The scene has no " << type << " " << key.id << endl;
+                return false;
+            }
+            this->transformationKeys.push_back(key);
+        }
+    }
+
+    stable_sort(this->cameraKeys.begin(), this->cameraKeys.end(), compareCameraKeys);
+    stable_sort(this->transformationKeys.begin(), this->transformationKeys.end(), compareTransformationKeys);
+    return true;
+}
+
+string Animation::getOutputPath(int frame)
+{
+    const char *percent = strchr(this->outputPattern.c_str(), '%');
+    size_t start = percent - this->outputPattern.c_str();
+    size_t end = this->outputPattern.find('d', start) + 1;
+    char number[64];
+
+    snprintf(number, sizeof(number), this->outputPattern.substr(start, end - start).c_str(), frame);
+    return this->outputPattern.substr(0, start) + number + this->outputPattern.substr(end);
+}
+
+void Animation::applyFrame(int frame, Scene *scene, Camera &camera)
+{
+    camera = *this->baseCamera;
+    camera.outputFilename = getOutputPath(frame);
+
+    if (!this->cameraKeys.empty())
+    {
+        // the last key at or before the frame and the one after it
+        int next = 0;
+        while (next < this->cameraKeys.size() && this->cameraKeys[next].frame <= frame)
+            next++;
+        CameraKey &a = this->cameraKeys[max(next - 1, 0)];
+        CameraKey &b = this->cameraKeys[min(next, (int)this->cameraKeys.size() - 1)];
+        double t = b.frame > a.frame ? (double)(frame - a.frame) / (b.frame - a.frame) : 0;
+
+        camera.position = interpolate(a.position, b.position, t);
+        camera.gaze = interpolate(a.gaze, b.gaze, t);
+        camera.v = interpolate(a.up, b.up, t);
+        camera.setupBasis();
+    }
+
+    for (int first = 0; first < this->transformationKeys.size();)
+    {
+        // keys first .. last - 1 belong to the same transformation
+        int last = first;
+        while (last < this->transformationKeys.size() && this->transformationKeys[last].type == this->transformationKeys[first].type &&
+               this->transformationKeys[last].id == this->transformationKeys[first].id)
+            last++;
+
+        int next = first;
+        while (next < last && this->transformationKeys[next].frame <= frame)
+            next++;
+        TransformationKey &a = this->transformationKeys[max(next - 1, first)];
+        TransformationKey &b = this->transformationKeys[min(next, last - 1)];
+        double t = b.frame > a.frame ? (double)(frame - a.frame) / (b.frame - a.frame) : 0;
+        double values[4];
+        for (int i = 0; i < 4; i++)
+            values[i] = interpolate(a.values[i], b.values[i], t);
+
+        scene->setTransformation(a.type, a.id, values);
+        first = last;
+    }
+
+    if (!this->transformationKeys.empty())
+        scene->updateModelingTransformations();
+}
@@ -0,0 +1,66 @@
+#ifndef __ANIMATION_H__
+#define __ANIMATION_H__
+#include <string>
+#include <vector>
+#include "Scene.h"
+
+class CameraKey
+{
+public:
+    int frame;
+    Vec3 position, gaze, up;
+};
+
+/*
+    Values of a translation (tx, ty, tz), scaling (sx, sy, sz) or rotation (angle, ux, uy, uz) at a frame.
+*/
+class TransformationKey
+{
+public:
+    int frame;
+    char type; // 't', 's' or 'r' as in Mesh::transformationTypes
+    int id;
+    double values[4];
+};
+
+/*
+    Keyframed camera path and transformations, read from a side XML file:
+        <Animation frames="120" camera="1" output="turntable_%04d.ppm">
+            <CameraKey frame="0" position="x y z" gaze="x y z" up="x y z" />
+            <TransformationKey frame="0" type="rotation" id="1" value="0 0 1 0" />
+            ...
+        </Animation>
+    Frames are numbered from 0. camera is the id of the scene camera whose image plane,
+    resolution and projection the frames use, the first camera when missing. output holds
+    one %d, with an optional zero padded width like %04d, for the frame number; without it
+    the frame number is added to the camera's output file name.
+    Values between keys are interpolated linearly, before the first and after the last key
+    of a camera or transformation they stay at the value of that key. The camera keeps its
+    scene position when it has no keys, transformations without keys keep their scene values.
+*/
+class Animation
+{
+public:
+    int frameCount, cameraId;
+    std::string outputPattern;
+    std::vector<CameraKey> cameraKeys;                 // by frame
+    std::vector<TransformationKey> transformationKeys; // by type, id and frame
+
+    Animation();
+
+    // prints what is wrong and returns false when the file is not a valid animation of the scene
+    bool load(const char *path, Scene *scene);
+
+    /*
+        Sets the transformations of the scene for the frame and makes camera the frame's camera.
+        The modeling transformations of the meshes are composed again when keys changed any.
+    */
+    void applyFrame(int frame, Scene *scene, Camera &camera);
+
+private:
+    Camera *baseCamera;
+
+    std::string getOutputPath(int frame);
+};
+
+#endif
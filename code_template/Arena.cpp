@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "Arena.h"
+
+using namespace std;
+
+Arena::Arena()
+{
+    this->next = NULL;
+    this->remaining = 0;
+}
+
+Arena::~Arena()
+{
+    release();
+    for (int i = 0; i < this->blocks.size(); i++)
+    {
+        free(this->blocks[i]);
+    }
+}
+
+/*
+    Returns size bytes aligned to alignment, from a new block if the current one is full.
+    Blocks double in size up to ARENA_MAX_BLOCK_SIZE, larger requests get a block of their own.
+*/
+void *Arena::allocate(size_t size, size_t alignment)
+{
+    size_t padding = (alignment - (uintptr_t)this->next % alignment) % alignment;
+
+    if (this->next == NULL || padding + size > this->remaining)
+    {
+        size_t blockSize = this->blocks.empty() ? ARENA_FIRST_BLOCK_SIZE : min(this->blockSizes.back() * 2, (size_t)ARENA_MAX_BLOCK_SIZE);
+        blockSize = max(blockSize, size + alignment);
+
+        char *block = (char *)malloc(blockSize);
+        if (block == NULL)
+        {
+            throw bad_alloc();
+        }
+        this->blocks.push_back(block);
+        this->blockSizes.push_back(blockSize);
+        this->next = block;
+        this->remaining = blockSize;
+        padding = (alignment - (uintptr_t)this->next % alignment) % alignment;
+    }
+
+    void *result = this->next + padding;
+    this->next += padding + size;
+    this->remaining -= padding + size;
+    return result;
+}
+
+void Arena::release()
+{
+    for (int i = (int)this->destructors.size() - 1; i >= 0; i--)
+    {
+        this->destructors[i].second(this->destructors[i].first);
+    }
+    this->destructors.clear();
+
+    // keep the first block for the next use
+    for (int i = 1; i < this->blocks.size(); i++)
+    {
+        free(this->blocks[i]);
+    }
+    this->blocks.resize(min((int)this->blocks.size(), 1));
+    this->blockSizes.resize(this->blocks.size());
+    this->next = this->blocks.empty() ? NULL : this->blocks[0];
+    this->remaining = this->blocks.empty() ? 0 : this->blockSizes[0];
+}
@@ -0,0 +1,73 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+#define ARENA_FIRST_BLOCK_SIZE (64 << 10)
+#define ARENA_MAX_BLOCK_SIZE (8 << 20)
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+    Bump allocator for objects that all live as long as their owner, such as the data of
+    a scene. Objects are placed one after another in large blocks and freed together by
+    release(), which runs the destructors that are not trivial in reverse order of
+    creation. The first block is kept for the next use, so a process loading many scenes
+    does not go back to malloc for small ones. Not thread safe.
+*/
+class Arena
+{
+public:
+    Arena();
+    ~Arena();
+
+    void *allocate(size_t size, size_t alignment);
+    void release();
+
+    template <class T, class... Args>
+    T *create(Args &&... args)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if (!std::is_trivially_destructible<T>::value)
+        {
+            this->destructors.push_back(std::make_pair((void *)object, &destroy<T>));
+        }
+        return object;
+    }
+
+    // count default constructed objects next to each other
+    template <class T>
+    T *createArray(size_t count)
+    {
+        T *objects = (T *)allocate(sizeof(T) * count, alignof(T));
+
+        for (size_t i = 0; i < count; i++)
+        {
+            new (objects + i) T();
+            if (!std::is_trivially_destructible<T>::value)
+            {
+                this->destructors.push_back(std::make_pair((void *)(objects + i), &destroy<T>));
+            }
+        }
+        return objects;
+    }
+
+private:
+    std::vector<char *> blocks;
+    std::vector<size_t> blockSizes;
+    char *next;
+    size_t remaining;
+    std::vector<std::pair<void *, void (*)(void *)> > destructors;
+
+    template <class T>
+    static void destroy(void *object)
+    {
+        ((T *)object)->~T();
+    }
+
+    Arena(const Arena &other);
+    Arena &operator=(const Arena &other);
+};
+
+#endif
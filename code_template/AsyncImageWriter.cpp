@@ -0,0 +1,102 @@
+#include "AsyncImageWriter.h"
+
+using namespace std;
+
+AsyncImageWriter::AsyncImageWriter(Scene *scene, int bufferCount)
+{
+    this->scene = scene;
+    this->writing = 0;
+    this->stopping = false;
+
+    for (int i = 0; i < bufferCount || i < 1; i++)
+    {
+        this->buffers.push_back(new FrameBuffer());
+        this->freeBuffers.push_back(this->buffers[i]);
+    }
+    this->worker = thread(&AsyncImageWriter::writerLoop, this);
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+    {
+        lock_guard<mutex> lock(this->queueMutex);
+        this->stopping = true;
+    }
+    this->changed.notify_all();
+    this->worker.join();
+
+    for (int i = 0; i < this->buffers.size(); i++)
+    {
+        delete this->buffers[i];
+    }
+}
+
+FrameBuffer *AsyncImageWriter::acquire()
+{
+    unique_lock<mutex> lock(this->queueMutex);
+
+    while (this->freeBuffers.empty())
+    {
+        this->changed.wait(lock);
+    }
+    FrameBuffer *frameBuffer = this->freeBuffers.back();
+    this->freeBuffers.pop_back();
+    return frameBuffer;
+}
+
+void AsyncImageWriter::submit(Camera *camera, FrameBuffer *frameBuffer)
+{
+    {
+        lock_guard<mutex> lock(this->queueMutex);
+        this->pending.push_back(make_pair(camera, frameBuffer));
+    }
+    this->changed.notify_all();
+}
+
+void AsyncImageWriter::flush()
+{
+    unique_lock<mutex> lock(this->queueMutex);
+
+    while (!this->pending.empty() || this->writing > 0)
+    {
+        this->changed.wait(lock);
+    }
+}
+
+void AsyncImageWriter::setScene(Scene *scene)
+{
+    flush();
+    this->scene = scene;
+}
+
+/*
+    Writes the submitted images in order. Before stopping, whatever is still pending is written.
+*/
+void AsyncImageWriter::writerLoop()
+{
+    unique_lock<mutex> lock(this->queueMutex);
+
+    while (true)
+    {
+        while (this->pending.empty() && !this->stopping)
+        {
+            this->changed.wait(lock);
+        }
+        if (this->pending.empty())
+        {
+            break;
+        }
+
+        pair<Camera *, FrameBuffer *> image = this->pending.front();
+        this->pending.pop_front();
+        this->writing++;
+        lock.unlock();
+
+        this->scene->writeImage(image.first, *image.second);
+
+        lock.lock();
+        this->writing--;
+        this->freeBuffers.push_back(image.second);
+        this->changed.notify_all();
+    }
+}
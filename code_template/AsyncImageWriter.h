@@ -0,0 +1,46 @@
+#ifndef __ASYNC_IMAGE_WRITER_H__
+#define __ASYNC_IMAGE_WRITER_H__
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Scene.h"
+
+/*
+    Encodes and writes finished images on a background thread while the next camera
+    is rendered. Frame buffers come from a fixed pool: a buffer taken with acquire()
+    is handed over with submit() and returns to the pool once its image is written,
+    so with two buffers rendering and writing are double buffered.
+*/
+class AsyncImageWriter
+{
+public:
+    Scene *scene;
+
+    AsyncImageWriter(Scene *scene, int bufferCount);
+    // blocks until every submitted image is written
+    ~AsyncImageWriter();
+
+    // a free frame buffer, waits while all of them are in use
+    FrameBuffer *acquire();
+    void submit(Camera *camera, FrameBuffer *frameBuffer);
+    void flush();
+
+    // writes the images of the current scene, then takes the ones of the given scene
+    void setScene(Scene *scene);
+
+private:
+    std::vector<FrameBuffer *> buffers;
+    std::vector<FrameBuffer *> freeBuffers;
+    std::deque<std::pair<Camera *, FrameBuffer *> > pending;
+    int writing;
+    bool stopping;
+    std::mutex queueMutex;
+    std::condition_variable changed;
+    std::thread worker;
+
+    void writerLoop();
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include <cstdio>
+#include "BandWriter.h"
+
+using namespace std;
+
+BandWriter::BandWriter(Scene *scene)
+{
+    this->scene = scene;
+    this->format = OUTPUT_PPM_ASCII;
+}
+
+void BandWriter::begin(Camera *camera)
+{
+    this->format = this->scene->getOutputFormat(camera);
+
+    if (this->format == OUTPUT_PNG)
+    {
+        this->file.open(this->scene->getOutputPath(camera, ".png").c_str(), ios::binary);
+        this->pngEncoder.begin(this->file, camera->horRes, camera->verRes);
+    }
+    else if (this->format == OUTPUT_QOI)
+    {
+        this->file.open(this->scene->getOutputPath(camera, ".qoi").c_str(), ios::binary);
+        this->qoiEncoder.begin(this->file, camera->horRes, camera->verRes);
+    }
+    else if (this->format == OUTPUT_PPM_BINARY)
+    {
+        this->file.open(camera->outputFilename.c_str(), ios::binary);
+        this->file << "P6\n" << camera->horRes << " " << camera->verRes << "\n255\n";
+    }
+    else
+    {
+        // same header and numbers as Scene::writeImageToPPMFile
+        this->file.open(camera->outputFilename.c_str());
+        this->file << "P3" << endl;
+        this->file << "# " << camera->outputFilename << endl;
+        this->file << camera->horRes << " " << camera->verRes << endl;
+        this->file << "255" << endl;
+    }
+}
+
+void BandWriter::writeBand(FrameBuffer &band)
+{
+    this->pixels.resize(band.width * band.height * 3);
+    band.quantize(&this->pixels[0]);
+
+    if (this->format == OUTPUT_PNG)
+    {
+        this->pngEncoder.writeRows(&this->pixels[0], band.height);
+    }
+    else if (this->format == OUTPUT_QOI)
+    {
+        this->qoiEncoder.writeRows(&this->pixels[0], band.height);
+    }
+    else if (this->format == OUTPUT_PPM_BINARY)
+    {
+        this->file.write((const char *)&this->pixels[0], this->pixels.size());
+    }
+    else
+    {
+        // quantize clamps like makeBetweenZeroAnd255, so the numbers match
+        char number[16];
+        const unsigned char *pixel = &this->pixels[0];
+
+        this->text.clear();
+        for (int j = 0; j < band.height; j++)
+        {
+            for (int i = 0; i < band.width; i++, pixel += 3)
+            {
+                this->text.append(number, sprintf(number, "%d %d %d ", pixel[0], pixel[1], pixel[2]));
+            }
+            this->text += '\n';
+        }
+        this->file << this->text;
+    }
+}
+
+void BandWriter::finish()
+{
+    if (this->format == OUTPUT_PNG)
+        this->pngEncoder.finish();
+    else if (this->format == OUTPUT_QOI)
+        this->qoiEncoder.finish();
+    this->file.close();
+}
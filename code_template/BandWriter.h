@@ -0,0 +1,34 @@
+#ifndef __BAND_WRITER_H__
+#define __BAND_WRITER_H__
+#include <fstream>
+#include <vector>
+#include "Scene.h"
+#include "PngEncoder.h"
+#include "QoiEncoder.h"
+
+/*
+    Writes an image that is rendered in horizontal bands, top band first. Each band is
+    encoded and written as soon as it is passed, in the format Scene::writeImage would
+    use for the camera, so only one band of the image is ever in memory.
+*/
+class BandWriter
+{
+public:
+    Scene *scene;
+
+    BandWriter(Scene *scene);
+
+    void begin(Camera *camera);
+    void writeBand(FrameBuffer &band);
+    void finish();
+
+private:
+    int format;
+    std::ofstream file;
+    PngEncoder pngEncoder;
+    QoiEncoder qoiEncoder;
+    std::vector<unsigned char> pixels;
+    std::string text;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include <thread>
+#include "BatchQueue.h"
+
+using namespace std;
+
+BatchQueue::BatchQueue() : head(0), tail(0), closed(false)
+{
+}
+
+PrimitiveBatch *BatchQueue::beginPush()
+{
+    long t = this->tail.load(memory_order_relaxed);
+
+    while (t - this->head.load(memory_order_acquire) >= BATCH_QUEUE_CAPACITY)
+    {
+        this_thread::yield();
+    }
+
+    PrimitiveBatch *batch = &this->slots[t % BATCH_QUEUE_CAPACITY];
+    batch->count = 0;
+    return batch;
+}
+
+void BatchQueue::endPush()
+{
+    this->tail.store(this->tail.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+void BatchQueue::close()
+{
+    this->closed.store(true, memory_order_release);
+}
+
+PrimitiveBatch *BatchQueue::beginPop()
+{
+    long h = this->head.load(memory_order_relaxed);
+
+    if (h == this->tail.load(memory_order_acquire))
+    {
+        return NULL;
+    }
+    return &this->slots[h % BATCH_QUEUE_CAPACITY];
+}
+
+void BatchQueue::endPop()
+{
+    this->head.store(this->head.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+bool BatchQueue::isClosed()
+{
+    return this->closed.load(memory_order_acquire);
+}
+
+void BatchQueue::reset()
+{
+    this->head.store(0);
+    this->tail.store(0);
+    this->closed.store(false);
+}
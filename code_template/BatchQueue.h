@@ -0,0 +1,38 @@
+#ifndef __BATCH_QUEUE_H__
+#define __BATCH_QUEUE_H__
+#define BATCH_QUEUE_CAPACITY 8
+#include <atomic>
+#include "PrimitiveBatch.h"
+
+/*
+    Bounded single-producer single-consumer ring of batches. The batches are filled and
+    drawn in place, so nothing is copied or allocated while rendering.
+*/
+class BatchQueue
+{
+public:
+    BatchQueue();
+
+    // producer side: the slot to fill, waits while the ring is full
+    PrimitiveBatch *beginPush();
+    void endPush();
+    // no batches follow, the consumer stops after draining the ring
+    void close();
+
+    // consumer side: the oldest filled batch, NULL if there is none
+    PrimitiveBatch *beginPop();
+    void endPop();
+    bool isClosed();
+
+    // prepares the ring for the next frame, only called while no thread uses it
+    void reset();
+
+private:
+    // the slots keep head and tail on separate cache lines
+    std::atomic<long> head; // next batch to pop
+    PrimitiveBatch slots[BATCH_QUEUE_CAPACITY];
+    std::atomic<long> tail; // next batch to push
+    std::atomic<bool> closed;
+};
+
+#endif
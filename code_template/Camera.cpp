@@ -1,6 +1,7 @@
 #include <iostream>
 #include <iomanip>
 #include "Camera.h"
+#include "Helpers.h"
 
 Camera::Camera() {}
 
@@ -64,6 +65,19 @@ std::ostream &operator<<(std::ostream &os, const Camera &c)
     return os;
 }
 
+/*
+    Completes the basis from the gaze and the up vector, which is read into v.
+*/
+void Camera::setupBasis() {
+    gaze = normalizeVec3(gaze);
+    u = crossProductVec3(gaze, v);
+    u = normalizeVec3(u);
+
+    w = inverseVec3(gaze);
+    v = crossProductVec3(u, gaze);
+    v = normalizeVec3(v);
+}
+
 Matrix4 Camera::getCameraTransformationMatrix() {
     Vec3 e = position;
     double matrix_values[4][4] = {
@@ -26,6 +26,7 @@ public:
 
     Camera(const Camera &other);
 
+    void setupBasis();
     Matrix4 getCameraTransformationMatrix();
     Matrix4 getProjectionTransformationMatrix();
     Matrix4 getViewportTransformationMatrix();
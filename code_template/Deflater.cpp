@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cstring>
+#include "Deflater.h"
+
+using namespace std;
+
+#ifndef USE_ZLIB
+// base values and extra bits of the length codes 257..285 and distance codes 0..29
+static const int lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const int lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const int distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                     257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const int distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                      7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Huffman codes are sent most significant bit first, the bit writer is least significant bit first
+static unsigned reverseBits(unsigned value, int count)
+{
+    unsigned result = 0;
+    for (int i = 0; i < count; i++)
+    {
+        result = (result << 1) | ((value >> i) & 1);
+    }
+    return result;
+}
+
+/*
+    Bit reversed fixed Huffman codes and lookup tables from lengths and distances to codes.
+*/
+class FixedHuffmanTables
+{
+public:
+    unsigned literalCodes[288];
+    int literalBits[288];
+    unsigned distanceCodes[30];
+    unsigned char lengthCode[DEFLATE_MAX_MATCH + 1];
+    unsigned char distanceCode[DEFLATE_WINDOW_SIZE + 1];
+
+    FixedHuffmanTables()
+    {
+        for (int symbol = 0; symbol < 288; symbol++)
+        {
+            if (symbol < 144)
+                literalCodes[symbol] = reverseBits(0x30 + symbol, literalBits[symbol] = 8);
+            else if (symbol < 256)
+                literalCodes[symbol] = reverseBits(0x190 + symbol - 144, literalBits[symbol] = 9);
+            else if (symbol < 280)
+                literalCodes[symbol] = reverseBits(symbol - 256, literalBits[symbol] = 7);
+            else
+                literalCodes[symbol] = reverseBits(0xc0 + symbol - 280, literalBits[symbol] = 8);
+        }
+        for (int code = 0; code < 30; code++)
+        {
+            distanceCodes[code] = reverseBits(code, 5);
+        }
+        for (int code = 0; code < 29; code++)
+        {
+            for (int length = lengthBase[code]; length <= DEFLATE_MAX_MATCH && (code == 28 || length < lengthBase[code + 1]); length++)
+                lengthCode[length] = code;
+        }
+        for (int code = 0; code < 30; code++)
+        {
+            for (int distance = distanceBase[code]; distance <= DEFLATE_WINDOW_SIZE && (code == 29 || distance < distanceBase[code + 1]); distance++)
+                distanceCode[distance] = code;
+        }
+    }
+};
+
+static const FixedHuffmanTables fixedTables;
+
+static inline unsigned hash3(const unsigned char *p)
+{
+    unsigned value = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+#endif
+
+Deflater::Deflater()
+{
+    this->started = false;
+    this->adlerA = 1;
+    this->adlerB = 0;
+#ifndef USE_ZLIB
+    this->windowStart = 0;
+    this->position = 0;
+    this->bitBuffer = 0;
+    this->bitCount = 0;
+#endif
+}
+
+Deflater::~Deflater()
+{
+#ifdef USE_ZLIB
+    if (this->started)
+    {
+        deflateEnd(&this->stream);
+    }
+#endif
+}
+
+void Deflater::start()
+{
+    this->started = true;
+    this->adlerA = 1;
+    this->adlerB = 0;
+#ifdef USE_ZLIB
+    memset(&this->stream, 0, sizeof(this->stream));
+    deflateInit(&this->stream, 1);
+#else
+    this->window.clear();
+    this->windowStart = 0;
+    this->position = 0;
+    this->head.assign(1 << DEFLATE_HASH_BITS, -1);
+    this->bitBuffer = 0;
+    this->bitCount = 0;
+
+    // zlib header: deflate with a 32K window, fastest compression
+    this->output.push_back(0x78);
+    this->output.push_back(0x01);
+#endif
+}
+
+void Deflater::updateAdler(const unsigned char *data, int size)
+{
+    unsigned a = this->adlerA, b = this->adlerB;
+
+    while (size > 0)
+    {
+        // 5552 bytes is the most that can be summed before the 32 bit sums overflow
+        int count = size < 5552 ? size : 5552;
+        for (int i = 0; i < count; i++)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += count;
+        size -= count;
+    }
+    this->adlerA = a;
+    this->adlerB = b;
+}
+
+void Deflater::writeAdler()
+{
+    unsigned adler = (this->adlerB << 16) | this->adlerA;
+
+    this->output.push_back(adler >> 24);
+    this->output.push_back((adler >> 16) & 0xff);
+    this->output.push_back((adler >> 8) & 0xff);
+    this->output.push_back(adler & 0xff);
+}
+
+#ifdef USE_ZLIB
+
+void Deflater::write(const unsigned char *data, int size)
+{
+    if (!this->started)
+        start();
+
+    unsigned char buffer[DEFLATE_BLOCK_SIZE];
+    this->stream.next_in = (Bytef *)data;
+    this->stream.avail_in = size;
+    do
+    {
+        this->stream.next_out = buffer;
+        this->stream.avail_out = sizeof(buffer);
+        deflate(&this->stream, Z_NO_FLUSH);
+        this->output.insert(this->output.end(), buffer, buffer + sizeof(buffer) - this->stream.avail_out);
+    } while (this->stream.avail_out == 0);
+}
+
+void Deflater::finish()
+{
+    if (!this->started)
+        start();
+
+    unsigned char buffer[DEFLATE_BLOCK_SIZE];
+    int result;
+    this->stream.avail_in = 0;
+    do
+    {
+        this->stream.next_out = buffer;
+        this->stream.avail_out = sizeof(buffer);
+        result = deflate(&this->stream, Z_FINISH);
+        this->output.insert(this->output.end(), buffer, buffer + sizeof(buffer) - this->stream.avail_out);
+    } while (result != Z_STREAM_END);
+
+    deflateEnd(&this->stream);
+    this->started = false;
+}
+
+#else
+
+void Deflater::putBits(unsigned value, int count)
+{
+    this->bitBuffer |= (unsigned long long)value << this->bitCount;
+    this->bitCount += count;
+
+    while (this->bitCount >= 8)
+    {
+        this->output.push_back(this->bitBuffer & 0xff);
+        this->bitBuffer >>= 8;
+        this->bitCount -= 8;
+    }
+}
+
+// fixed Huffman code of a literal or length symbol
+void Deflater::putLiteral(int symbol)
+{
+    putBits(fixedTables.literalCodes[symbol], fixedTables.literalBits[symbol]);
+}
+
+void Deflater::putMatch(int length, int distance)
+{
+    int code = fixedTables.lengthCode[length];
+    putLiteral(257 + code);
+    putBits(length - lengthBase[code], lengthExtra[code]);
+
+    code = fixedTables.distanceCode[distance];
+    putBits(fixedTables.distanceCodes[code], 5);
+    putBits(distance - distanceBase[code], distanceExtra[code]);
+}
+
+/*
+    Compresses window[position, end) into one fixed Huffman block. Matches may look past
+    end into the pending input, they stop at the end of the window.
+*/
+void Deflater::compressBlock(int end, bool final)
+{
+    const unsigned char *data = this->window.empty() ? NULL : &this->window[0];
+    int size = this->window.size();
+    int i = this->position;
+
+    putBits(final ? 1 : 0, 1);
+    putBits(1, 2);
+
+    while (i < end)
+    {
+        int length = 0;
+        int distance = 0;
+
+        if (i + DEFLATE_MIN_MATCH <= size)
+        {
+            unsigned h = hash3(data + i);
+            long candidate = this->head[h] - this->windowStart;
+            this->head[h] = this->windowStart + i;
+
+            if (candidate >= 0 && i - candidate <= DEFLATE_WINDOW_SIZE)
+            {
+                int limit = min(DEFLATE_MAX_MATCH, size - i);
+                const unsigned char *a = data + i;
+                const unsigned char *b = data + candidate;
+
+                while (length < limit && a[length] == b[length])
+                    length++;
+                distance = i - candidate;
+            }
+        }
+
+        if (length >= DEFLATE_MIN_MATCH)
+        {
+            putMatch(length, distance);
+
+            // a few positions inside the match keep the hash table fresh, the rest are skipped for speed
+            int last = min(i + length, size - DEFLATE_MIN_MATCH + 1);
+            for (int j = i + 1; j < last && j < i + 4; j++)
+            {
+                this->head[hash3(data + j)] = this->windowStart + j;
+            }
+            i += length;
+        }
+        else
+        {
+            putLiteral(data[i]);
+            i++;
+        }
+    }
+
+    putLiteral(256);
+    this->position = i;
+}
+
+void Deflater::write(const unsigned char *data, int size)
+{
+    if (!this->started)
+        start();
+
+    updateAdler(data, size);
+    this->window.insert(this->window.end(), data, data + size);
+
+    // keep DEFLATE_MAX_MATCH bytes back so that matches are not cut short by the next write
+    while ((int)this->window.size() - this->position >= DEFLATE_BLOCK_SIZE + DEFLATE_MAX_MATCH)
+    {
+        compressBlock(this->position + DEFLATE_BLOCK_SIZE, false);
+
+        if (this->position > 2 * DEFLATE_WINDOW_SIZE)
+        {
+            int drop = this->position - DEFLATE_WINDOW_SIZE;
+            this->window.erase(this->window.begin(), this->window.begin() + drop);
+            this->windowStart += drop;
+            this->position -= drop;
+        }
+    }
+}
+
+void Deflater::finish()
+{
+    if (!this->started)
+        start();
+
+    compressBlock(this->window.size(), true);
+    if (this->bitCount > 0)
+    {
+        putBits(0, 8 - this->bitCount);
+    }
+    writeAdler();
+    this->started = false;
+}
+
+#endif
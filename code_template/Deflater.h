@@ -0,0 +1,58 @@
+#ifndef __DEFLATER_H__
+#define __DEFLATER_H__
+#define DEFLATE_WINDOW_SIZE 32768
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_BLOCK_SIZE 65536
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#include <vector>
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+/*
+    Streaming zlib (RFC 1950/1951) compressor. Data is passed in pieces with write()
+    and compressed output is appended to the output vector, which the caller may empty
+    at any time. Without USE_ZLIB a built-in fast compressor is used: LZ77 matches found
+    through a single hash lookup, coded with the fixed Huffman tables. Compile with
+    -DUSE_ZLIB and link with -lz to use zlib instead.
+*/
+class Deflater
+{
+public:
+    std::vector<unsigned char> output;
+
+    Deflater();
+    ~Deflater();
+
+    void write(const unsigned char *data, int size);
+    // compresses the rest of the data and ends the stream, the deflater can then be reused
+    void finish();
+
+private:
+#ifdef USE_ZLIB
+    z_stream stream;
+    bool started;
+#else
+    std::vector<unsigned char> window; // up to DEFLATE_WINDOW_SIZE bytes of history followed by pending input
+    long windowStart;                  // stream position of window[0]
+    int position;                      // index in window of the next byte to compress
+    std::vector<long> head;            // last stream position of every 3 byte hash, -1 when none
+    unsigned long long bitBuffer;
+    int bitCount;
+    bool started;
+#endif
+    unsigned adlerA, adlerB;
+
+    void start();
+    void updateAdler(const unsigned char *data, int size);
+    void writeAdler();
+#ifndef USE_ZLIB
+    void putBits(unsigned value, int count);
+    void putLiteral(int literal);
+    void putMatch(int length, int distance);
+    void compressBlock(int end, bool final);
+#endif
+};
+
+#endif
@@ -0,0 +1,32 @@
+#include <iomanip>
+#include "Edge.h"
+
+Edge::Edge()
+{
+    this->vertexIds[0] = -1;
+    this->vertexIds[1] = -1;
+    this->triangleIds[0] = NO_TRIANGLE;
+    this->triangleIds[1] = NO_TRIANGLE;
+}
+
+Edge::Edge(int vid1, int vid2, int triangleId)
+{
+    this->vertexIds[0] = vid1;
+    this->vertexIds[1] = vid2;
+    this->triangleIds[0] = triangleId;
+    this->triangleIds[1] = NO_TRIANGLE;
+}
+
+Edge::Edge(const Edge &other)
+{
+    this->vertexIds[0] = other.vertexIds[0];
+    this->vertexIds[1] = other.vertexIds[1];
+    this->triangleIds[0] = other.triangleIds[0];
+    this->triangleIds[1] = other.triangleIds[1];
+}
+
+std::ostream &operator<<(std::ostream &os, const Edge &e)
+{
+    os << std::fixed << std::setprecision(0) << "Edge with vertices (" << e.vertexIds[0] << ", " << e.vertexIds[1] << ") shared by triangles (" << e.triangleIds[0] << ", " << e.triangleIds[1] << ")";
+    return os;
+}
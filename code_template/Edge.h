@@ -0,0 +1,18 @@
+#ifndef __EDGE_H__
+#define __EDGE_H__
+#define NO_TRIANGLE -1
+#include <iostream>
+
+class Edge
+{
+public:
+    int vertexIds[2];
+    int triangleIds[2]; // indices into Mesh::triangles of the triangles sharing this edge, NO_TRIANGLE if unused
+
+    Edge();
+    Edge(int vid1, int vid2, int triangleId);
+    Edge(const Edge &other);
+    friend std::ostream &operator<<(std::ostream &os, const Edge &e);
+};
+
+#endif
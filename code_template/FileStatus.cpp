@@ -0,0 +1,39 @@
+#include <sys/stat.h>
+#include "FileStatus.h"
+
+using namespace std;
+
+FileStatus::FileStatus()
+{
+    this->modificationTime = 0;
+    this->size = 0;
+}
+
+bool FileStatus::read(const string &path)
+{
+    struct stat status;
+
+    this->path = path;
+    if (stat(path.c_str(), &status) != 0)
+    {
+        this->modificationTime = 0;
+        this->size = -1;
+        return false;
+    }
+#if defined(__APPLE__)
+    this->modificationTime = status.st_mtimespec.tv_sec * 1000000000LL + status.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    this->modificationTime = status.st_mtime * 1000000000LL;
+#else
+    this->modificationTime = status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec;
+#endif
+    this->size = status.st_size;
+    return true;
+}
+
+bool FileStatus::isUnchanged() const
+{
+    FileStatus current;
+    current.read(this->path);
+    return current.modificationTime == this->modificationTime && current.size == this->size;
+}
@@ -0,0 +1,24 @@
+#ifndef __FILE_STATUS_H__
+#define __FILE_STATUS_H__
+#include <string>
+
+/*
+    Modification time and size of a file at the time it was read, to tell later
+    whether the file has changed since.
+*/
+class FileStatus
+{
+public:
+    std::string path;
+    long long modificationTime, size; // in nanoseconds and bytes, size is -1 when the file can not be read
+
+    FileStatus();
+
+    // returns false when the file can not be read
+    bool read(const std::string &path);
+
+    // returns true when the file still has the modification time and size read before, or is still missing
+    bool isUnchanged() const;
+};
+
+#endif
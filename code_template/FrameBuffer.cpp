@@ -0,0 +1,138 @@
+#include "FrameBuffer.h"
+
+FrameBuffer::FrameBuffer()
+{
+    this->width = 0;
+    this->height = 0;
+    this->rowOffset = 0;
+    this->keepKeys = false;
+}
+
+FrameBuffer::FrameBuffer(int width, int height)
+{
+    this->width = 0;
+    this->height = 0;
+    this->rowOffset = 0;
+    this->keepKeys = false;
+    resize(width, height);
+}
+
+/*
+    Changes the size of the targets, existing allocations are reused when they are large enough.
+*/
+void FrameBuffer::resize(int width, int height)
+{
+    resizeBand(width, 0, height);
+}
+
+/*
+    Makes the buffer hold rows rowOffset .. rowOffset + rows - 1 of an image width pixels wide.
+*/
+void FrameBuffer::resizeBand(int width, int rowOffset, int rows)
+{
+    this->rowOffset = rowOffset;
+    this->width = width;
+    this->height = rows;
+    this->colors.resize(width * rows);
+    this->depths.resize(width * rows);
+    this->keys.resize(this->keepKeys ? width * rows : 0);
+}
+
+void FrameBuffer::clearColor(Color backgroundColor)
+{
+    for (int i = 0; i < this->colors.size(); i++)
+    {
+        this->colors[i] = backgroundColor;
+    }
+}
+
+void FrameBuffer::clearColor(Color backgroundColor, Region &region)
+{
+    for (int y = region.yMin; y <= region.yMax; y++)
+    {
+        for (int x = region.xMin; x <= region.xMax; x++)
+        {
+            this->colors[(y - this->rowOffset) * this->width + x] = backgroundColor;
+        }
+    }
+}
+
+void FrameBuffer::clearDepth()
+{
+    for (int i = 0; i < this->depths.size(); i++)
+    {
+        this->depths[i] = MAX_DEPTH;
+    }
+    for (int i = 0; i < this->keys.size(); i++)
+    {
+        this->keys[i] = NO_KEY;
+    }
+}
+
+void FrameBuffer::quantize(unsigned char *pixels)
+{
+    quantizeRows(this->height - 1, 0, pixels);
+}
+
+/*
+    Quantizes rows top down to bottom, the output of row top starts at pixels.
+    A row is a flat run of doubles, converted QUANTIZE_LANES values at a time
+    with selects instead of branches, so that the compiler uses SIMD conversions.
+*/
+void FrameBuffer::quantizeRows(int top, int bottom, unsigned char *pixels)
+{
+    int count = this->width * 3;
+
+    for (int y = top; y >= bottom; y--)
+    {
+        const double *values = &this->colors[y * this->width].r;
+        unsigned char *out = pixels + (top - y) * count;
+        int i = 0;
+
+        for (; i + QUANTIZE_LANES <= count; i += QUANTIZE_LANES)
+        {
+            int lanes[QUANTIZE_LANES];
+
+            for (int j = 0; j < QUANTIZE_LANES; j++)
+            {
+                double value = values[i + j];
+                value = value > 0.0 ? value : 0.0;
+                value = value < 255.0 ? value : 255.0;
+                lanes[j] = (int)value;
+            }
+            for (int j = 0; j < QUANTIZE_LANES; j++)
+            {
+                out[i + j] = (unsigned char)lanes[j];
+            }
+        }
+        for (; i < count; i++)
+        {
+            double value = values[i];
+            value = value > 0.0 ? value : 0.0;
+            value = value < 255.0 ? value : 255.0;
+            out[i] = (unsigned char)(int)value;
+        }
+    }
+}
+
+// region is in image coordinates
+void FrameBuffer::clearDepth(Region &region)
+{
+    for (int y = region.yMin; y <= region.yMax; y++)
+    {
+        for (int x = region.xMin; x <= region.xMax; x++)
+        {
+            this->depths[(y - this->rowOffset) * this->width + x] = MAX_DEPTH;
+        }
+    }
+    if (this->keepKeys)
+    {
+        for (int y = region.yMin; y <= region.yMax; y++)
+        {
+            for (int x = region.xMin; x <= region.xMax; x++)
+            {
+                this->keys[(y - this->rowOffset) * this->width + x] = NO_KEY;
+            }
+        }
+    }
+}
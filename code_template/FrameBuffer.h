@@ -0,0 +1,46 @@
+#ifndef __FRAME_BUFFER_H__
+#define __FRAME_BUFFER_H__
+#define MAX_DEPTH 99.99
+#define NO_KEY 0x7fffffffffffffffLL
+#define QUANTIZE_LANES 8
+#include <iostream>
+#include <vector>
+#include "Color.h"
+#include "Region.h"
+
+/*
+    Color and depth targets of a render, stored row by row in flat arrays.
+    Pixel (x, y) is at index (y - rowOffset) * width + x, row 0 is the bottom row of the image.
+    A buffer made by resizeBand holds only the rows rowOffset .. rowOffset + height - 1
+    of a taller image, the rasterizers take image coordinates either way.
+    With keepKeys set, every pixel also keeps the key of the primitive that was drawn into
+    it and primitives of equal depth are resolved by the smaller key instead of by the
+    order they arrive in, which makes the image independent of thread timing.
+*/
+class FrameBuffer
+{
+public:
+    int width, height;
+    int rowOffset; // image row stored in the first row of the buffer
+    std::vector<Color> colors;
+    std::vector<double> depths;
+    bool keepKeys;
+    std::vector<long long> keys;
+
+    FrameBuffer();
+    FrameBuffer(int width, int height);
+
+    void resize(int width, int height);
+    void resizeBand(int width, int rowOffset, int rows);
+    void clearColor(Color backgroundColor);
+    void clearColor(Color backgroundColor, Region &region);
+    void clearDepth();
+    void clearDepth(Region &region);
+
+    // writes the colors as 8-bit RGB, top row first, clamped the same way as Scene::makeBetweenZeroAnd255.
+    // top and bottom are rows of the buffer, not of the image
+    void quantize(unsigned char *pixels);
+    void quantizeRows(int top, int bottom, unsigned char *pixels);
+};
+
+#endif
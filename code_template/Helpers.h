@@ -75,8 +75,4 @@ Matrix4 multiplyMatrixWithMatrix(Matrix4 m1, Matrix4 m2);
 Vec4 multiplyMatrixWithVec4(Matrix4 m, Vec4 v);
 
 void printMatrix(Matrix4 m);
-
-std::vector<Vec4> copyVec4(std::vector<Vec4> vertices, int start_index, int end_index);
-
-std::vector<Color> copyColor(std::vector<Color> colors, int start_index, int end_index);
 #endif
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include <cstring>
+#include "IncrementalRenderer.h"
+
+using namespace std;
+
+static bool isSameVec3(Vec3 &a, Vec3 &b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static bool isSameMatrix(Matrix4 &a, Matrix4 &b)
+{
+    return memcmp(a.values, b.values, sizeof(a.values)) == 0;
+}
+
+IncrementalRenderer::IncrementalRenderer(Scene *scene)
+{
+    this->scene = scene;
+    this->rendered = false;
+    this->frameBuffer.keepKeys = true;
+}
+
+bool IncrementalRenderer::isSameCamera(Camera *camera)
+{
+    Camera &last = this->lastCamera;
+
+    return last.projectionType == camera->projectionType && last.horRes == camera->horRes && last.verRes == camera->verRes &&
+           isSameVec3(last.position, camera->position) && isSameVec3(last.gaze, camera->gaze) &&
+           isSameVec3(last.u, camera->u) && isSameVec3(last.v, camera->v) && isSameVec3(last.w, camera->w) &&
+           last.left == camera->left && last.right == camera->right && last.bottom == camera->bottom &&
+           last.top == camera->top && last.near == camera->near && last.far == camera->far;
+}
+
+/*
+    Sets up the primitives of the mesh the same way Scene::forwardRenderingPipeline
+    does, keyed by their ids, keeps them and returns their screen bounds.
+*/
+Region IncrementalRenderer::setupMesh(int meshIndex, Camera *camera)
+{
+    Scene *scene = this->scene;
+    Mesh *mesh = scene->meshes[meshIndex];
+    Matrix4 transformationMatrix = scene->getTransformationMatrix(mesh, camera);
+    int width = this->frameBuffer.width;
+    int height = this->frameBuffer.height;
+    long long firstKey = (long long)meshIndex << 32;
+    vector<ScreenTriangle> &triangles = this->triangles[meshIndex];
+    vector<ScreenLine> &lines = this->lines[meshIndex];
+    Region bounds;
+
+    triangles.clear();
+    lines.clear();
+    this->transformedVertices.clear();
+    if (mesh->hasCompactVertexRange())
+    {
+        this->transformedVertices.resize(mesh->lastVertexId - mesh->firstVertexId + 1);
+        scene->transformVertices(mesh, transformationMatrix, 0, this->transformedVertices.size(), this->transformedVertices);
+    }
+
+    if (mesh->type == WIREFRAME_MESH)
+    {
+        this->frontFacing.clear();
+        if (scene->cullingEnabled)
+        {
+            this->frontFacing.resize(mesh->triangles.size());
+            scene->computeFrontFacing(mesh, transformationMatrix, this->transformedVertices, 0, mesh->triangles.size(), this->frontFacing);
+        }
+
+        LineBatch batch;
+        ScreenLine screenLines[LINE_BATCH_SIZE];
+        for (int i = 0; i <= (int)mesh->edges.size(); i++)
+        {
+            if (i < mesh->edges.size())
+            {
+                Edge &edge = mesh->edges[i];
+                if (!scene->isEdgeVisible(edge, this->frontFacing))
+                    continue;
+
+                Vec4 transformed_vertex_0 = scene->getTransformedVertex(mesh, edge.vertexIds[0], transformationMatrix, this->transformedVertices);
+                Vec4 transformed_vertex_1 = scene->getTransformedVertex(mesh, edge.vertexIds[1], transformationMatrix, this->transformedVertices);
+                batch.add(transformed_vertex_0, transformed_vertex_1, *scene->colorsOfVertices[edge.vertexIds[0] - 1], *scene->colorsOfVertices[edge.vertexIds[1] - 1]);
+            }
+
+            // the last pass flushes what is left in the batch
+            if (batch.isFull() || i == mesh->edges.size())
+            {
+                int count = scene->setupLineBatch(batch, this->viewportTransformationMatrix, width, height, screenLines);
+                for (int k = 0; k < count; k++)
+                {
+                    screenLines[k].key = firstKey + lines.size();
+                    bounds.add(screenLines[k].bounds);
+                    lines.push_back(screenLines[k]);
+                }
+            }
+        }
+    }
+    else
+    {
+        ScreenTriangle screenTriangle;
+        for (int i = 0; i < mesh->triangles.size(); i++)
+        {
+            if (scene->setupTriangle(mesh->triangles[i], mesh, transformationMatrix, this->transformedVertices,
+                                     this->viewportTransformationMatrix, width, height, screenTriangle))
+            {
+                screenTriangle.key = firstKey + i;
+                bounds.add(screenTriangle.bounds);
+                triangles.push_back(screenTriangle);
+            }
+        }
+    }
+    return bounds;
+}
+
+void IncrementalRenderer::drawMesh(int meshIndex, Region &region)
+{
+    vector<ScreenTriangle> &triangles = this->triangles[meshIndex];
+    vector<ScreenLine> &lines = this->lines[meshIndex];
+
+    for (int i = 0; i < triangles.size(); i++)
+    {
+        if (triangles[i].bounds.intersects(region))
+            this->scene->rasterizeTriangle(triangles[i], this->frameBuffer, region);
+    }
+    for (int i = 0; i < lines.size(); i++)
+    {
+        if (lines[i].bounds.intersects(region))
+            this->scene->rasterizeLine(lines[i], this->frameBuffer, region);
+    }
+}
+
+Region IncrementalRenderer::render(Camera *camera)
+{
+    Scene *scene = this->scene;
+    int meshCount = scene->meshes.size();
+    Region dirty;
+    bool full = !this->rendered || !isSameCamera(camera) || this->meshBounds.size() != meshCount;
+
+    if (full)
+    {
+        this->frameBuffer.resize(camera->horRes, camera->verRes);
+        this->viewportTransformationMatrix = camera->getViewportTransformationMatrix();
+        this->meshBounds.assign(meshCount, Region());
+        this->modelingTransformations.resize(meshCount);
+        this->triangles.resize(meshCount);
+        this->lines.resize(meshCount);
+        dirty = Region(0, 0, camera->horRes - 1, camera->verRes - 1);
+    }
+    else
+    {
+        vector<char> changed(meshCount, 0);
+        bool anyChanged = false;
+
+        for (int i = 0; i < meshCount; i++)
+        {
+            changed[i] = !isSameMatrix(this->modelingTransformations[i], scene->meshes[i]->modelingTransformation);
+            anyChanged = anyChanged || changed[i];
+        }
+        if (!anyChanged)
+            return dirty;
+
+        // where the changed meshes were visible
+        FrameBuffer &frameBuffer = this->frameBuffer;
+        for (int y = 0; y < frameBuffer.height; y++)
+        {
+            for (int x = 0; x < frameBuffer.width; x++)
+            {
+                long long key = frameBuffer.keys[y * frameBuffer.width + x];
+                if (key != NO_KEY && changed[key >> 32])
+                {
+                    Region pixel(x, y, x, y);
+                    dirty.add(pixel);
+                }
+            }
+        }
+
+        // and where they are now
+        for (int i = 0; i < meshCount; i++)
+        {
+            if (changed[i])
+            {
+                this->meshBounds[i] = setupMesh(i, camera);
+                dirty.add(this->meshBounds[i]);
+            }
+        }
+    }
+
+    this->lastCamera = *camera;
+    for (int i = 0; i < meshCount; i++)
+    {
+        this->modelingTransformations[i] = scene->meshes[i]->modelingTransformation;
+    }
+    if (dirty.isEmpty())
+        return dirty;
+
+    this->frameBuffer.clearColor(scene->backgroundColor, dirty);
+    this->frameBuffer.clearDepth(dirty);
+
+    for (int i = 0; i < meshCount; i++)
+    {
+        if (full)
+            this->meshBounds[i] = setupMesh(i, camera);
+        if (this->meshBounds[i].intersects(dirty))
+            drawMesh(i, dirty);
+    }
+    this->rendered = true;
+    return dirty;
+}
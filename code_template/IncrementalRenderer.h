@@ -0,0 +1,52 @@
+#ifndef __INCREMENTAL_RENDERER_H__
+#define __INCREMENTAL_RENDERER_H__
+#include <vector>
+#include "Scene.h"
+
+/*
+    Renders one camera again and again while the modeling transformations of meshes
+    change, redrawing only the part of the image those changes can touch.
+    The frame buffer keeps colors, depths and, as its keys, the id of the primitive
+    drawn at every pixel: the mesh index in the high 32 bits and the triangle or line
+    index inside the mesh in the low ones. Since these keys follow the drawing order
+    of Scene::forwardRenderingPipeline, depth ties resolve the same way and the image
+    always equals a full render.
+
+    When meshes changed since the last render, the dirty region is the bounding box of
+    - the pixels whose id belongs to a changed mesh, where it was visible before, and
+    - the screen bounds of the changed meshes with their new transformations.
+    Only that region is cleared, and only meshes whose last screen bounds overlap it
+    are drawn again, clipped to it. The set up primitives of every mesh are kept between
+    renders, so only the changed meshes are transformed and set up again.
+*/
+class IncrementalRenderer
+{
+public:
+    Scene *scene;
+    FrameBuffer frameBuffer;
+
+    IncrementalRenderer(Scene *scene);
+
+    /*
+        Renders the camera into frameBuffer and returns the region that was redrawn.
+        The whole image is drawn the first time, and whenever the camera changed.
+    */
+    Region render(Camera *camera);
+
+private:
+    Camera lastCamera;
+    bool rendered;
+    std::vector<Matrix4> modelingTransformations; // of the meshes at the last render
+    std::vector<Region> meshBounds;               // screen bounds of the primitives of the meshes at the last render
+    std::vector<std::vector<ScreenTriangle> > triangles; // set up primitives of the meshes at the last render
+    std::vector<std::vector<ScreenLine> > lines;
+    std::vector<Vec4> transformedVertices;
+    std::vector<char> frontFacing;
+    Matrix4 viewportTransformationMatrix;
+
+    bool isSameCamera(Camera *camera);
+    Region setupMesh(int meshIndex, Camera *camera);
+    void drawMesh(int meshIndex, Region &region);
+};
+
+#endif
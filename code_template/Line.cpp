@@ -0,0 +1,26 @@
+#include <iomanip>
+#include "Line.h"
+
+Line::Line() {}
+
+Line::Line(Vec4 v0, Vec4 v1, Color c0, Color c1)
+{
+    this->vertices[0] = v0;
+    this->vertices[1] = v1;
+    this->colors[0] = c0;
+    this->colors[1] = c1;
+}
+
+Line::Line(const Line &other)
+{
+    this->vertices[0] = other.vertices[0];
+    this->vertices[1] = other.vertices[1];
+    this->colors[0] = other.colors[0];
+    this->colors[1] = other.colors[1];
+}
+
+std::ostream &operator<<(std::ostream &os, const Line &l)
+{
+    os << "Line from " << l.vertices[0] << " " << l.colors[0] << " to " << l.vertices[1] << " " << l.colors[1];
+    return os;
+}
@@ -0,0 +1,19 @@
+#ifndef __LINE_H__
+#define __LINE_H__
+#include <iostream>
+#include "Vec4.h"
+#include "Color.h"
+
+class Line
+{
+public:
+    Vec4 vertices[2];
+    Color colors[2];
+
+    Line();
+    Line(Vec4 v0, Vec4 v1, Color c0, Color c1);
+    Line(const Line &other);
+    friend std::ostream &operator<<(std::ostream &os, const Line &l);
+};
+
+#endif
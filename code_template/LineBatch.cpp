@@ -0,0 +1,109 @@
+#include <cstring>
+#include "LineBatch.h"
+
+LineBatch::LineBatch()
+{
+    // lanes past count are clipped along with the real lines, keep them initialized
+    memset(this, 0, sizeof(LineBatch));
+}
+
+bool LineBatch::isFull()
+{
+    return this->count == LINE_BATCH_SIZE;
+}
+
+void LineBatch::add(Vec4 &v0, Vec4 &v1, Color &c0, Color &c1)
+{
+    int i = this->count++;
+
+    x0[i] = v0.x;
+    y0[i] = v0.y;
+    z0[i] = v0.z;
+    x1[i] = v1.x;
+    y1[i] = v1.y;
+    z1[i] = v1.z;
+
+    r0[i] = c0.r;
+    g0[i] = c0.g;
+    b0[i] = c0.b;
+    r1[i] = c1.r;
+    g1[i] = c1.g;
+    b1[i] = c1.b;
+}
+
+/*
+    Branch-free version of the Liang-Barsky visibility test for one boundary.
+    Lines parallel to and outside of the boundary end up with tEnter > tLeave.
+*/
+static inline void clipAgainstBoundary(double den, double num, double &tEnter, double &tLeave)
+{
+    double t = num / den;
+
+    // non short-circuit operators keep the loop free of branches so it can be vectorized
+    tEnter = ((den > 0) & (t > tEnter)) ? t : tEnter;
+    tLeave = ((den < 0) & (t < tLeave)) ? t : tLeave;
+    tLeave = ((den == 0) & (num > 0)) ? -1.0 : tLeave;
+}
+
+int LineBatch::clip(Line *clippedLines)
+{
+    // round up to whole lane groups, spare lanes hold stale or zero lines and are ignored below
+    int laneCount = (this->count + LINE_BATCH_LANES - 1) / LINE_BATCH_LANES * LINE_BATCH_LANES;
+
+    for (int start = 0; start < laneCount; start += LINE_BATCH_LANES)
+    {
+        for (int i = start; i < start + LINE_BATCH_LANES; i++)
+        {
+            double dx = x1[i] - x0[i];
+            double dy = y1[i] - y0[i];
+            double dz = z1[i] - z0[i];
+            double tE = 0.0;
+            double tL = 1.0;
+
+            clipAgainstBoundary(dx, -1 - x0[i], tE, tL);  // left
+            clipAgainstBoundary(-dx, x0[i] - 1, tE, tL);  // right
+            clipAgainstBoundary(dy, -1 - y0[i], tE, tL);  // bottom
+            clipAgainstBoundary(-dy, y0[i] - 1, tE, tL);  // top
+            clipAgainstBoundary(dz, -1 - z0[i], tE, tL);  // back
+            clipAgainstBoundary(-dz, z0[i] - 1, tE, tL);  // front
+
+            tEnter[i] = tE;
+            tLeave[i] = tL;
+        }
+    }
+
+    int visibleCount = 0;
+    for (int i = 0; i < this->count; i++)
+    {
+        if (tEnter[i] > tLeave[i])
+            continue;
+
+        double dx = x1[i] - x0[i];
+        double dy = y1[i] - y0[i];
+        double dz = z1[i] - z0[i];
+        Line &line = clippedLines[visibleCount++];
+
+        line.vertices[0] = Vec4(x0[i], y0[i], z0[i], 1);
+        line.vertices[1] = Vec4(x1[i], y1[i], z1[i], 1);
+        line.colors[0] = Color(r0[i], g0[i], b0[i]);
+        line.colors[1] = Color(r1[i], g1[i], b1[i]);
+
+        if (tLeave[i] < 1)
+        {
+            line.vertices[1] = Vec4(x0[i] + dx * tLeave[i], y0[i] + dy * tLeave[i], z0[i] + dz * tLeave[i], 1);
+            line.colors[1] = Color(r0[i] + (r1[i] - r0[i]) * tLeave[i],
+                                   g0[i] + (g1[i] - g0[i]) * tLeave[i],
+                                   b0[i] + (b1[i] - b0[i]) * tLeave[i]);
+        }
+        if (tEnter[i] > 0)
+        {
+            line.vertices[0] = Vec4(x0[i] + dx * tEnter[i], y0[i] + dy * tEnter[i], z0[i] + dz * tEnter[i], 1);
+            line.colors[0] = Color(r0[i] + (r1[i] - r0[i]) * tEnter[i],
+                                   g0[i] + (g1[i] - g0[i]) * tEnter[i],
+                                   b0[i] + (b1[i] - b0[i]) * tEnter[i]);
+        }
+    }
+
+    this->count = 0;
+    return visibleCount;
+}
@@ -0,0 +1,36 @@
+#ifndef __LINE_BATCH_H__
+#define __LINE_BATCH_H__
+#define LINE_BATCH_SIZE 64
+#define LINE_BATCH_LANES 8
+#include "Vec4.h"
+#include "Color.h"
+#include "Line.h"
+
+/*
+    Lines waiting to be clipped, stored as structure of arrays so that
+    Liang-Barsky clipping runs on LINE_BATCH_LANES lines at a time.
+*/
+class LineBatch
+{
+public:
+    int count;
+    double x0[LINE_BATCH_SIZE], y0[LINE_BATCH_SIZE], z0[LINE_BATCH_SIZE];
+    double x1[LINE_BATCH_SIZE], y1[LINE_BATCH_SIZE], z1[LINE_BATCH_SIZE];
+    double r0[LINE_BATCH_SIZE], g0[LINE_BATCH_SIZE], b0[LINE_BATCH_SIZE];
+    double r1[LINE_BATCH_SIZE], g1[LINE_BATCH_SIZE], b1[LINE_BATCH_SIZE];
+    double tEnter[LINE_BATCH_SIZE], tLeave[LINE_BATCH_SIZE];
+
+    LineBatch();
+
+    bool isFull();
+    void add(Vec4 &v0, Vec4 &v1, Color &c0, Color &c1);
+
+    /*
+        Clips every line in the batch against the canonical view volume and writes
+        the visible ones into clippedLines. Returns the number of visible lines
+        and empties the batch.
+    */
+    int clip(Line *clippedLines);
+};
+
+#endif
@@ -1,41 +1,688 @@
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <fstream>
 #include "Scene.h"
+#include "SceneCache.h"
+#include "ThreadPool.h"
+#include "TiledRenderer.h"
+#include "StreamingRenderer.h"
+#include "AsyncImageWriter.h"
+#include "OutOfCoreRenderer.h"
+#include "BandWriter.h"
+#include "RenderServer.h"
+#include "Animation.h"
+#include "VideoWriter.h"
+
+#define WRITE_BUFFER_COUNT 2 // frame buffers of the image writer, so rendering and writing are double buffered
 
 using namespace std;
 
 Scene *scene;
+AsyncImageWriter *writer; // NULL when images are written on the rendering thread
+VideoWriter *videoWriter; // NULL when every image goes to its own file
+
+/*
+    Returns the cleared frame buffer to render the camera into.
+*/
+FrameBuffer *beginImage(Camera *camera)
+{
+    FrameBuffer *frameBuffer = writer != NULL ? writer->acquire() : &scene->frameBuffer;
+
+    scene->initializeImage(camera, *frameBuffer);
+    return frameBuffer;
+}
+
+/*
+    Writes the rendered image, in the background when there is a writer.
+*/
+void endImage(Camera *camera, FrameBuffer *frameBuffer, ThreadPool *pool)
+{
+    if (writer != NULL)
+        writer->submit(camera, frameBuffer);
+    else if (pool != NULL)
+        scene->writeImage(camera, *frameBuffer, pool);
+    else
+        scene->writeImage(camera, *frameBuffer);
+}
+
+/*
+    Renders the camera into the given frame buffer and writes its output files.
+    The scratch space is the caller's, so that concurrent cameras do not share it.
+*/
+void renderCamera(Camera *camera, FrameBuffer &frameBuffer, vector<Vec4> &transformedVertices, vector<char> &frontFacing)
+{
+    // initialize image with basic values
+    scene->initializeImage(camera, frameBuffer);
+
+    // do forward rendering pipeline operations
+    scene->forwardRenderingPipeline(camera, frameBuffer, transformedVertices, frontFacing);
+
+    // generate PPM or PNG file, PNG files are encoded in process instead of converting the PPM file
+    scene->writeImage(camera, frameBuffer);
+}
+
+/*
+    Renders the cameras on a pool of threads. Each thread takes the next camera that is
+    not rendered yet and renders it into its own frame buffer, the scene is shared read-only.
+*/
+void renderCamerasInParallel(int jobs)
+{
+    atomic<int> nextCamera(0);
+    vector<thread> workers;
+
+    for (int i = 0; i < jobs; i++)
+    {
+        workers.push_back(thread([&nextCamera]()
+        {
+            FrameBuffer frameBuffer;
+            vector<Vec4> transformedVertices;
+            vector<char> frontFacing;
+
+            for (int j = nextCamera++; j < (int)scene->cameras.size(); j = nextCamera++)
+            {
+                renderCamera(scene->cameras[j], frameBuffer, transformedVertices, frontFacing);
+            }
+        }));
+    }
+
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+}
+
+/*
+    Renders the cameras one after another, splitting the work of each camera over the pool.
+*/
+void renderCamerasOnPool(ThreadPool &pool)
+{
+    TiledRenderer renderer(scene, &pool);
+
+    for (int i = 0; i < scene->cameras.size(); i++)
+    {
+        Camera *camera = scene->cameras[i];
+        FrameBuffer *frameBuffer = beginImage(camera);
+
+        renderer.render(camera, *frameBuffer);
+        endImage(camera, frameBuffer, &pool);
+    }
+}
+
+/*
+    Renders the cameras one after another in bands of at least bandRows rows on a pool
+    of threads. Each band is encoded and written before the next one is drawn, so only
+    one band of the image is in memory.
+*/
+void renderCamerasInBands(int threads, int bandRows)
+{
+    ThreadPool pool(threads);
+    TiledRenderer renderer(scene, &pool);
+    BandWriter bandWriter(scene);
+    FrameBuffer band;
+
+    for (int i = 0; i < scene->cameras.size(); i++)
+    {
+        Camera *camera = scene->cameras[i];
+
+        bandWriter.begin(camera);
+        renderer.renderBands(camera, bandRows, band, [&bandWriter](FrameBuffer &finishedBand)
+        {
+            bandWriter.writeBand(finishedBand);
+        });
+        bandWriter.finish();
+    }
+}
+
+/*
+    Renders the cameras one after another with streams threads doing geometry and
+    streams threads doing rasterization.
+*/
+void renderCamerasStreaming(int streams, bool deterministic)
+{
+    StreamingRenderer renderer(scene, streams, streams, deterministic);
+
+    for (int i = 0; i < scene->cameras.size(); i++)
+    {
+        Camera *camera = scene->cameras[i];
+        FrameBuffer *frameBuffer = beginImage(camera);
+
+        renderer.render(camera, *frameBuffer);
+        endImage(camera, frameBuffer, NULL);
+    }
+}
+
+/*
+    Returns true when the cache file exists, is of this version and the XML file and every
+    OBJ or PLY file it was imported from still have the modification time and size they
+    had when the cache was written.
+*/
+bool isSceneCacheCurrent(const char *xmlPath, const string &cachePath)
+{
+    if (!isSceneCacheFile(cachePath.c_str()))
+    {
+        return false;
+    }
+
+    SceneCacheFile cache;
+    FileStatus xmlFile;
+    vector<FileStatus> importedFiles;
+    if (!cache.open(cachePath.c_str()) || !cache.readSourceFile(xmlFile) || !cache.readImportedFiles(importedFiles))
+    {
+        return false;
+    }
+
+    // the cache lies next to the XML file, which may have been named by another relative path when it was written
+    xmlFile.path = xmlPath;
+    if (!xmlFile.isUnchanged())
+    {
+        return false;
+    }
+    for (int i = 0; i < importedFiles.size(); i++)
+    {
+        if (!importedFiles[i].isUnchanged())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    Loads the scene from the cache file next to the XML file. The cache is written
+    first when it is missing, of another version or the XML file or a mesh file it
+    imports changed since it was written.
+*/
+Scene *loadCachedScene(const char *xmlPath)
+{
+    string cachePath = string(xmlPath) + ".cache";
+
+    if (isSceneCacheCurrent(xmlPath, cachePath))
+    {
+        return new Scene(cachePath.c_str());
+    }
+
+    Scene *scene = new Scene(xmlPath);
+    if (!writeSceneCache(scene, cachePath.c_str()))
+    {
+        cerr << "Could not write the scene cache " << cachePath << endl;
+    }
+    return scene;
+}
+
+/*
+    Returns the path of an up to date cache of the scene for out-of-core rendering.
+    Cache files are used as they are, XML files are converted once, which needs the
+    whole XML scene in memory.
+*/
+string updateSceneCache(const char *xmlPath)
+{
+    if (isSceneCacheFile(xmlPath))
+    {
+        return xmlPath;
+    }
+
+    string cachePath = string(xmlPath) + ".cache";
+    if (!isSceneCacheCurrent(xmlPath, cachePath))
+    {
+        Scene xmlScene(xmlPath);
+
+        if (!writeSceneCache(&xmlScene, cachePath.c_str()))
+        {
+            cerr << "Could not write the scene cache " << cachePath << endl;
+        }
+    }
+    return cachePath;
+}
+
+/*
+    Renders the cameras one after another, streaming the geometry from the scene cache.
+*/
+void renderCamerasOutOfCore(OutOfCoreRenderer &renderer)
+{
+    for (int i = 0; i < scene->cameras.size(); i++)
+    {
+        Camera *camera = scene->cameras[i];
+        FrameBuffer *frameBuffer = beginImage(camera);
+
+        renderer.render(camera, *frameBuffer);
+        endImage(camera, frameBuffer, NULL);
+    }
+}
+
+/*
+    Renders the cameras one after another on the calling thread.
+*/
+void renderCamerasSerially()
+{
+    for (int i = 0; i < scene->cameras.size(); i++)
+    {
+        Camera *camera = scene->cameras[i];
+        FrameBuffer *frameBuffer = beginImage(camera);
+
+        // do forward rendering pipeline operations
+        scene->forwardRenderingPipeline(camera, *frameBuffer);
+        endImage(camera, frameBuffer, NULL);
+    }
+}
+
+/*
+    Renders the frames of the animation one after another on the pool. The scene is
+    loaded, and its meshes' edges and vertex ranges are found, once for all frames;
+    the renderer keeps its chunk buffers across frames, and the writer writes each
+    frame while the next one renders.
+*/
+void renderAnimation(Animation &animation, ThreadPool &pool)
+{
+    TiledRenderer renderer(scene, &pool);
+    /*
+        A frame's camera has to live until its image is written. The writer holds at
+        most WRITE_BUFFER_COUNT frames, so a ring of one more camera is never reused
+        while a frame queued with it is still waiting.
+    */
+    vector<Camera> cameras(WRITE_BUFFER_COUNT + 1);
+
+    for (int frame = 0; frame < animation.frameCount; frame++)
+    {
+        Camera *camera = &cameras[frame % cameras.size()];
+
+        // the previous frame is rendered and the writer only reads its frame buffer
+        animation.applyFrame(frame, scene, *camera);
+
+        FrameBuffer *frameBuffer = beginImage(camera);
+        renderer.render(camera, *frameBuffer);
+        endImage(camera, frameBuffer, &pool);
+    }
+
+    // the queued frames point into cameras
+    if (writer != NULL)
+        writer->flush();
+}
+
+Scene *loadScene(const char *path, bool useCache, int outputFormat)
+{
+    Scene *loaded = useCache ? loadCachedScene(path) : new Scene(path);
+
+    loaded->outputFormat = outputFormat;
+    loaded->videoWriter = videoWriter;
+    return loaded;
+}
+
+/*
+    Adds the scene files listed in the manifest, one path per line. Empty lines and
+    lines starting with '#' are skipped, relative paths are relative to the manifest.
+*/
+bool readManifest(const char *manifestPath, vector<string> &paths)
+{
+    ifstream manifest(manifestPath);
+    string line;
+
+    if (!manifest)
+    {
+        cerr << "Could not read the manifest " << manifestPath << endl;
+        return false;
+    }
+
+    string directory = manifestPath;
+    size_t slash = directory.find_last_of("/\\");
+    directory = slash == string::npos ? "" : directory.substr(0, slash + 1);
+
+    while (getline(manifest, line))
+    {
+        size_t end = line.find_last_not_of(" \t\r");
+        if (end == string::npos || line[0] == '#')
+            continue;
+
+        string name = line.substr(0, end + 1);
+        bool absolute = name[0] == '/' || name[0] == '\\' || (name.size() > 1 && name[1] == ':');
+        paths.push_back(absolute ? name : directory + name);
+    }
+    return true;
+}
+
+/*
+    Renders several scenes in one process. The next scene is loaded on its own thread
+    while the current one is rendered, and the thread pool, the image writer and its
+    frame buffers are shared by all scenes, so only the first scene pays for starting
+    them. Two scenes are in memory at a time.
+*/
+void renderBatch(vector<string> &paths, int threads, bool asyncOutput, bool useCache, int outputFormat)
+{
+    ThreadPool *pool = threads != 1 ? new ThreadPool(threads > 0 ? threads : thread::hardware_concurrency()) : NULL;
+    Scene *next = loadScene(paths[0].c_str(), useCache, outputFormat);
+
+    scene = NULL;
+    writer = asyncOutput ? new AsyncImageWriter(next, WRITE_BUFFER_COUNT) : NULL;
+
+    for (int i = 0; i < paths.size(); i++)
+    {
+        Scene *previous = scene;
+        scene = next;
+        next = NULL;
+
+        if (writer != NULL)
+        {
+            writer->setScene(scene);
+        }
+        if (previous != NULL)
+        {
+            // the frame buffer keeps its memory for the next scene
+            swap(scene->frameBuffer, previous->frameBuffer);
+            delete previous;
+        }
+
+        thread loader;
+        if (i + 1 < paths.size())
+        {
+            loader = thread([&next, &paths, i, useCache, outputFormat]()
+            {
+                next = loadScene(paths[i + 1].c_str(), useCache, outputFormat);
+            });
+        }
+
+        if (pool != NULL)
+            renderCamerasOnPool(*pool);
+        else
+            renderCamerasSerially();
+
+        if (loader.joinable())
+        {
+            loader.join();
+        }
+    }
+
+    // waits for the images still being written before the last scene goes
+    delete writer;
+    writer = NULL;
+    delete scene;
+    delete pool;
+}
 
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    const char *xmlPath = NULL;
+    int jobs = 1;
+    int threads = 1;
+    int streams = 0;
+    bool deterministic = false;
+    int outputFormat = OUTPUT_BY_EXTENSION;
+    bool asyncOutput = true;
+    bool useCache = false;
+    const char *cacheOutputPath = NULL;
+    bool outOfCore = false;
+    int bandRows = 0;
+    const char *socketPath = NULL;
+    const char *manifestPath = NULL;
+    const char *animationPath = NULL;
+    const char *videoPath = NULL;
+    int videoFormat = VIDEO_Y4M;
+    int framesPerSecond = 25;
+    VideoWriter video;
+    vector<string> inputPaths;
+    bool usage = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+        {
+            jobs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc)
+        {
+            streams = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "p3") == 0)
+                outputFormat = OUTPUT_PPM_ASCII;
+            else if (strcmp(argv[i], "p6") == 0)
+                outputFormat = OUTPUT_PPM_BINARY;
+            else if (strcmp(argv[i], "png") == 0)
+                outputFormat = OUTPUT_PNG;
+            else if (strcmp(argv[i], "qoi") == 0)
+                outputFormat = OUTPUT_QOI;
+            else
+            {
+                usage = true;
+                break;
+            }
+        }
+        else if (strcmp(argv[i], "--sync-output") == 0)
+        {
+            asyncOutput = false;
+        }
+        else if (strcmp(argv[i], "--cache") == 0)
+        {
+            useCache = true;
+        }
+        else if (strcmp(argv[i], "--write-cache") == 0 && i + 1 < argc)
+        {
+            cacheOutputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--band-rows") == 0 && i + 1 < argc)
+        {
+            bandRows = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--out-of-core") == 0)
+        {
+            outOfCore = true;
+        }
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+        {
+            socketPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--animate") == 0 && i + 1 < argc)
+        {
+            animationPath = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--video") == 0 || strcmp(argv[i], "--raw-video") == 0) && i + 1 < argc)
+        {
+            videoFormat = strcmp(argv[i], "--video") == 0 ? VIDEO_Y4M : VIDEO_RGB;
+            videoPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+        {
+            framesPerSecond = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            manifestPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--deterministic") == 0)
+        {
+            deterministic = true;
+        }
+        else
+        {
+            inputPaths.push_back(argv[i]);
+        }
+    }
+
+    if (manifestPath != NULL && !readManifest(manifestPath, inputPaths))
+    {
+        return 1;
+    }
+    bool batch = inputPaths.size() > 1 || manifestPath != NULL;
+    if (inputPaths.size() == 1)
+    {
+        xmlPath = inputPaths[0].c_str();
+    }
+
+    // a server takes its scenes from the requests instead of the command line
+    if (usage || (socketPath != NULL ? !inputPaths.empty() : inputPaths.empty()) ||
+        (batch && (jobs != 1 || streams > 0 || bandRows > 0 || outOfCore || cacheOutputPath != NULL)) ||
+        (animationPath != NULL && (batch || jobs != 1 || streams > 0 || bandRows > 0 || outOfCore || cacheOutputPath != NULL)) ||
+        (videoPath != NULL && (socketPath != NULL || jobs != 1 || bandRows > 0 || cacheOutputPath != NULL || framesPerSecond <= 0)))
     {
         cout << "Please run the rasterizer as:" << endl
-             << "\t./rasterizer <input_file_name>" << endl;
+             << "\t./rasterizer [--jobs N | --threads N | --stream N [--deterministic]] [--band-rows N] [--format p3|p6|png|qoi] [--sync-output] [--cache | --write-cache FILE | --out-of-core] <input_file_name>" << endl
+             << "\t./rasterizer [--threads N] [--format p3|p6|png|qoi] [--sync-output] [--cache] [--batch MANIFEST] <input_file_name>..." << endl
+             << "\t./rasterizer --animate ANIMATION [--threads N] [--format p3|p6|png|qoi] [--sync-output] [--cache] <input_file_name>" << endl
+             << "\t./rasterizer --serve SOCKET [--threads N]" << endl
+             << "\t(--video FILE [--fps N] and --raw-video FILE go with all but --jobs, --band-rows, --write-cache and --serve)" << endl
+             << "\t--jobs N: render N cameras at the same time, 0 uses every core" << endl
+             << "\t--threads N: render each camera with N threads, 0 uses every core" << endl
+             << "\t--stream N: render each camera with N geometry and N raster threads connected by queues" << endl
+             << "\t--deterministic: make --stream output identical to the single threaded output" << endl
+             << "\t(--jobs and --threads output always is)" << endl
+             << "\t--band-rows N: render and write each image in bands of at least N rows (rounded up" << endl
+             << "\t         to whole tiles) to bound the frame buffer memory, using the --threads threads" << endl
+             << "\t--format: p3 writes ASCII PPM files, p6 binary PPM files, png and qoi PNG and QOI files" << endl
+             << "\t         named after the output file with a .png or .qoi extension. Without it the" << endl
+             << "\t         format follows the extension of each output file, other extensions get P3" << endl
+             << "\t--sync-output: write each image before rendering the next camera instead of in the background" << endl
+             << "\t--cache: load the scene from <input_file_name>.cache, writing it first when the input changed since" << endl
+             << "\t--write-cache FILE: convert the input to a scene cache file and exit without rendering" << endl
+             << "\t--out-of-core: render from the scene cache without loading the geometry into memory," << endl
+             << "\t         one camera at a time on one thread. XML input is converted to <input_file_name>.cache first" << endl
+             << "\t(input files starting with a scene cache header are always loaded as caches)" << endl
+             << "\t--batch MANIFEST: also render the scene files listed in MANIFEST, one per line, relative to it. Several" << endl
+             << "\t         input files are rendered in one process, loading the next scene while one renders" << endl
+             << "\t--animate ANIMATION: render the numbered frames of the keyframed camera path and" << endl
+             << "\t         transformations in the ANIMATION file, see Animation.h for its format" << endl
+             << "\t--video FILE: write all images as the frames of one Y4M (YUV4MPEG2, 4:2:0) stream instead of" << endl
+             << "\t         one file per camera, - writes to the standard output. Images must have the same size" << endl
+             << "\t--raw-video FILE: the same with raw 8-bit RGB frames, top row first" << endl
+             << "\t--fps N: frame rate written in the Y4M header, 25 by default" << endl
+             << "\t--serve SOCKET: keep parsed scenes in memory and render them on requests sent to the Unix" << endl
+             << "\t         domain socket SOCKET until interrupted, see RenderServer.h for the request format" << endl;
         return 1;
     }
+
+    if (videoPath != NULL)
+    {
+        if (!video.open(videoPath, videoFormat, framesPerSecond))
+        {
+            return 1;
+        }
+        videoWriter = &video;
+    }
+
+    if (batch)
+    {
+        renderBatch(inputPaths, threads, asyncOutput, useCache, outputFormat);
+        return 0;
+    }
+    else if (socketPath != NULL)
+    {
+        ThreadPool pool(threads > 0 ? threads : thread::hardware_concurrency());
+        RenderServer server(&pool);
+
+        if (!server.listen(socketPath))
+        {
+            return 1;
+        }
+        server.run();
+        return 0;
+    }
+    else if (outOfCore)
+    {
+        scene = new Scene();
+        scene->outputFormat = outputFormat;
+        scene->videoWriter = videoWriter;
+
+        OutOfCoreRenderer renderer(scene);
+        if (!renderer.open(updateSceneCache(xmlPath).c_str()))
+        {
+            cerr << "Could not read the scene cache of " << xmlPath << endl;
+            delete scene;
+            return 1;
+        }
+
+        writer = asyncOutput ? new AsyncImageWriter(scene, WRITE_BUFFER_COUNT) : NULL;
+        renderCamerasOutOfCore(renderer);
+        delete writer;
+        delete scene;
+        return 0;
+    }
     else
     {
-        const char *xmlPath = argv[1];
+        scene = useCache ? loadCachedScene(xmlPath) : new Scene(xmlPath);
+        scene->outputFormat = outputFormat;
+        scene->videoWriter = videoWriter;
 
-        scene = new Scene(xmlPath);
+        if (cacheOutputPath != NULL)
+        {
+            if (!writeSceneCache(scene, cacheOutputPath))
+            {
+                cerr << "Could not write the scene cache " << cacheOutputPath << endl;
+                delete scene;
+                return 1;
+            }
+            delete scene;
+            return 0;
+        }
 
-        for (int i = 0; i < scene->cameras.size(); i++)
+        if (bandRows > 0)
         {
-            // initialize image with basic values
-            scene->initializeImage(scene->cameras[i]);
+            renderCamerasInBands(threads > 0 ? threads : thread::hardware_concurrency(), bandRows);
+            delete scene;
+            return 0;
+        }
 
-            // do forward rendering pipeline operations
-            scene->forwardRenderingPipeline(scene->cameras[i]);
+        if (animationPath != NULL)
+        {
+            Animation animation;
+            if (!animation.load(animationPath, scene))
+            {
+                delete scene;
+                return 1;
+            }
 
-            // generate PPM file
-            scene->writeImageToPPMFile(scene->cameras[i]);
+            ThreadPool pool(threads > 0 ? threads : thread::hardware_concurrency());
+            writer = asyncOutput ? new AsyncImageWriter(scene, WRITE_BUFFER_COUNT) : NULL;
+            renderAnimation(animation, pool);
+            delete writer;
+            delete scene;
+            return 0;
+        }
 
-            // Converts PPM image in given path to PNG file, by calling ImageMagick's 'convert' command.
-            // Notice that os_type is not given as 1 (Ubuntu) or 2 (Windows), below call doesn't do conversion.
-            // Change os_type to 1 or 2, after being sure that you have ImageMagick installed.
-            scene->convertPPMToPNG(scene->cameras[i]->outputFilename, 0);
+        if (jobs <= 0)
+        {
+            jobs = thread::hardware_concurrency();
+        }
+        if (jobs > (int)scene->cameras.size())
+        {
+            jobs = scene->cameras.size();
+        }
+
+        // parallel jobs already overlap writing one camera with rendering the others
+        if (jobs > 1 && streams <= 0 && threads == 1)
+        {
+            renderCamerasInParallel(jobs);
+            delete scene;
+            return 0;
+        }
+
+        // two frame buffers: one being rendered, one being written
+        writer = asyncOutput ? new AsyncImageWriter(scene, WRITE_BUFFER_COUNT) : NULL;
+
+        if (streams > 0)
+        {
+            renderCamerasStreaming(streams, deterministic);
+        }
+        else if (threads != 1)
+        {
+            ThreadPool pool(threads > 0 ? threads : thread::hardware_concurrency());
+            renderCamerasOnPool(pool);
+        }
+        else
+        {
+            renderCamerasSerially();
         }
 
+        // waits for the images still being written, then frees the scene's arena
+        delete writer;
+        delete scene;
         return 0;
     }
-}
\ No newline at end of file
+}
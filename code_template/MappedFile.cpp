@@ -0,0 +1,91 @@
+#include <cstdio>
+#include "MappedFile.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    this->data = NULL;
+    this->size = 0;
+    this->mapping = NULL;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char *path)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path, O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat status;
+        if (fstat(fd, &status) == 0 && status.st_size > 0)
+        {
+            void *mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+                this->mapping = mapping;
+                this->data = (const char *)mapping;
+                this->size = status.st_size;
+            }
+        }
+        ::close(fd);
+        if (this->mapping != NULL)
+            return true;
+    }
+#endif
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    char chunk[65536];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        this->buffer.insert(this->buffer.end(), chunk, chunk + count);
+    }
+    fclose(file);
+
+    this->data = this->buffer.empty() ? NULL : &this->buffer[0];
+    this->size = this->buffer.size();
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifndef _WIN32
+    if (this->mapping != NULL)
+    {
+        munmap(this->mapping, this->size);
+    }
+#endif
+    this->mapping = NULL;
+    this->buffer.clear();
+    this->data = NULL;
+    this->size = 0;
+}
+
+void MappedFile::release(const void *begin, size_t size)
+{
+#ifndef _WIN32
+    if (this->mapping == NULL || size == 0)
+        return;
+
+    // madvise needs a page aligned start, the partial page before begin is released too
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t start = ((const char *)begin - this->data) / pageSize * pageSize;
+    size_t end = (const char *)begin - this->data + size;
+    madvise((char *)this->mapping + start, end - start, MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,36 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+#include <cstddef>
+#include <vector>
+
+/*
+    Read-only view of a whole file. The file is memory-mapped where the platform
+    supports it and read into memory otherwise.
+*/
+class MappedFile
+{
+public:
+    const char *data;
+    size_t size;
+
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const char *path);
+    void close();
+
+    /*
+        Drops the pages of [begin, begin + size) from memory, they are read from the
+        file again when touched. Does nothing when the file is not memory-mapped.
+    */
+    void release(const void *begin, size_t size);
+
+private:
+    void *mapping;
+    std::vector<char> buffer;
+
+    MappedFile(const MappedFile &other);
+    MappedFile &operator=(const MappedFile &other);
+};
+
+#endif
@@ -1,8 +1,14 @@
 #include <vector>
+#include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include "Mesh.h"
 
-Mesh::Mesh() {}
+Mesh::Mesh()
+{
+    this->firstVertexId = 1;
+    this->lastVertexId = 0;
+}
 
 Mesh::Mesh(int meshId, int type, int numberOfTransformations,
            std::vector<int> transformationIds,
@@ -17,6 +23,81 @@ Mesh::Mesh(int meshId, int type, int numberOfTransformations,
     this->transformationIds = transformationIds;
     this->transformationTypes = transformationTypes;
     this->triangles = triangles;
+    computeVertexRange();
+}
+
+struct EdgeEntry
+{
+    int lowVertexId, highVertexId, order; // order = triangle index * 3 + edge index inside the triangle
+};
+
+static bool compareEdgeEntries(const EdgeEntry &a, const EdgeEntry &b)
+{
+    if (a.lowVertexId != b.lowVertexId)
+        return a.lowVertexId < b.lowVertexId;
+    if (a.highVertexId != b.highVertexId)
+        return a.highVertexId < b.highVertexId;
+    return a.order < b.order;
+}
+
+static bool compareOrderedEdges(const std::pair<int, Edge> &a, const std::pair<int, Edge> &b)
+{
+    return a.first < b.first;
+}
+
+/*
+    Collects the unique edges of the mesh so that an edge shared by two triangles is clipped and drawn once.
+    Every edge keeps the triangles it belongs to, so it can be skipped when all of them are culled.
+    An edge shared by more than two triangles is split into several edges of at most two triangles each.
+    Edges keep the orientation and drawing order of their first occurrence in the face list.
+*/
+void Mesh::buildEdgeList()
+{
+    std::vector<EdgeEntry> entries(this->triangles.size() * 3);
+
+    for (int i = 0; i < this->triangles.size(); i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            int v0 = this->triangles[i].vertexIds[k];
+            int v1 = this->triangles[i].vertexIds[(k + 1) % 3];
+            EdgeEntry &entry = entries[i * 3 + k];
+
+            entry.lowVertexId = std::min(v0, v1);
+            entry.highVertexId = std::max(v0, v1);
+            entry.order = i * 3 + k;
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), compareEdgeEntries);
+
+    std::vector<std::pair<int, Edge> > orderedEdges;
+    for (int i = 0; i < entries.size(); i++)
+    {
+        int order = entries[i].order;
+        int triangleId = order / 3;
+        int k = order % 3;
+        Edge edge(this->triangles[triangleId].vertexIds[k], this->triangles[triangleId].vertexIds[(k + 1) % 3], triangleId);
+
+        if (i + 1 < entries.size() &&
+            entries[i + 1].lowVertexId == entries[i].lowVertexId &&
+            entries[i + 1].highVertexId == entries[i].highVertexId)
+        {
+            edge.triangleIds[1] = entries[i + 1].order / 3;
+            i++;
+        }
+
+        orderedEdges.push_back(std::make_pair(order, edge));
+    }
+
+    std::sort(orderedEdges.begin(), orderedEdges.end(), compareOrderedEdges);
+
+    this->edges.clear();
+    this->edges.reserve(orderedEdges.size());
+    for (int i = 0; i < orderedEdges.size(); i++)
+    {
+        this->edges.push_back(orderedEdges[i].second);
+    }
 }
 
 std::ostream &operator<<(std::ostream &os, const Mesh &m)
@@ -44,3 +125,35 @@ std::ostream &operator<<(std::ostream &os, const Mesh &m)
 
     return os;
 }
+
+void Mesh::computeVertexRange()
+{
+    this->firstVertexId = 1;
+    this->lastVertexId = 0;
+
+    for (int i = 0; i < this->triangles.size(); i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            int id = this->triangles[i].vertexIds[k];
+
+            if (this->lastVertexId < this->firstVertexId)
+            {
+                this->firstVertexId = id;
+                this->lastVertexId = id;
+            }
+            this->firstVertexId = std::min(this->firstVertexId, id);
+            this->lastVertexId = std::max(this->lastVertexId, id);
+        }
+    }
+}
+
+/*
+    Meshes usually list their vertices together, then transforming the whole range once
+    is cheaper than transforming the vertices of every triangle. A mesh whose few
+    triangles pick vertices from all over the scene is transformed per triangle instead.
+*/
+bool Mesh::hasCompactVertexRange()
+{
+    return this->lastVertexId - this->firstVertexId + 1 <= MESH_COMPACT_RANGE_FACTOR * (long long)this->triangles.size();
+}
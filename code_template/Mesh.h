@@ -2,7 +2,12 @@
 #define __MESH_H__
 #define WIREFRAME_MESH 0
 #define SOLID_MESH 1
+#define MESH_COMPACT_RANGE_FACTOR 3 // vertex ids per triangle a mesh may span and still be transformed as a whole
+#include <string>
+#include <vector>
 #include "Triangle.h"
+#include "Edge.h"
+#include "Matrix4.h"
 
 class Mesh
 {
@@ -12,6 +17,10 @@ public:
     std::vector<int> transformationIds;
     std::vector<char> transformationTypes;
     std::vector<Triangle> triangles;
+    std::vector<Edge> edges; // unique edges of the triangles, filled by buildEdgeList() for wireframe meshes
+    Matrix4 modelingTransformation; // the transformations composed once when the scene is loaded
+    std::string fileName;           // OBJ or PLY file holding more faces of the mesh, empty for none
+    int firstVertexId, lastVertexId; // range of the vertex ids used by the triangles, set by computeVertexRange()
 
     Mesh();
     Mesh(int meshId, int type, int numberOfTransformations,
@@ -20,6 +29,9 @@ public:
          int numberOfTriangles,
          std::vector<Triangle> triangles);
 
+    void buildEdgeList();
+    void computeVertexRange();
+    bool hasCompactVertexRange();
     friend std::ostream &operator<<(std::ostream &os, const Mesh &m);
 };
 
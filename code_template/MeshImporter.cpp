@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "MeshImporter.h"
+#include "MappedFile.h"
+#include "TextParser.h"
+#include "Scene.h"
+
+using namespace std;
+
+#define PLY_LIST -1
+
+/*
+    A range of whole lines of an OBJ file, parsed by one thread.
+*/
+struct ObjPiece
+{
+    const char *begin, *end;
+    int firstVertex; // number of vertices of the file before the piece
+    int vertexCount;
+    vector<Triangle> triangles;
+};
+
+static inline const char *skipBlanks(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+static inline bool isLine(const char *p, const char *end, char kind)
+{
+    return end - p >= 2 && p[0] == kind && (p[1] == ' ' || p[1] == '\t');
+}
+
+/*
+    Calls parseLine(line, lineEnd) for every line of the piece. A last line without a
+    newline is copied, so that the number parsers never read past the end of the file.
+*/
+static void forEachLine(ObjPiece &piece, const function<void(const char *, const char *)> &parseLine)
+{
+    string lastLine;
+
+    for (const char *line = piece.begin; line < piece.end;)
+    {
+        const char *newline = (const char *)memchr(line, '\n', piece.end - line);
+
+        if (newline == NULL)
+        {
+            lastLine.assign(line, piece.end);
+            parseLine(lastLine.c_str(), lastLine.c_str() + lastLine.size());
+            break;
+        }
+        parseLine(line, newline);
+        line = newline + 1;
+    }
+}
+
+static void countOBJVertices(ObjPiece &piece)
+{
+    int count = 0;
+
+    forEachLine(piece, [&count](const char *line, const char *lineEnd)
+    {
+        count += isLine(skipBlanks(line, lineEnd), lineEnd, 'v');
+    });
+    piece.vertexCount = count;
+}
+
+/*
+    Parses the lines of the piece. Vertices go straight to their place in the scene,
+    firstId is the scene id of the first vertex of the file.
+*/
+static void parseOBJPiece(ObjPiece &piece, Scene *scene, int firstId, int fileVertexCount)
+{
+    int vertexCount = piece.firstVertex;
+    vector<int> polygon;
+
+    forEachLine(piece, [&](const char *line, const char *lineEnd)
+    {
+        line = skipBlanks(line, lineEnd);
+
+        if (isLine(line, lineEnd, 'v'))
+        {
+            double values[6];
+            int count = 0;
+
+            for (const char *p = skipBlanks(line + 1, lineEnd); count < 6 && p < lineEnd; p = skipBlanks(p, lineEnd))
+            {
+                const char *after = parseDouble(p, values[count]);
+                if (after == p)
+                    break;
+                p = after;
+                count++;
+            }
+
+            int id = firstId + vertexCount;
+            *scene->vertices[id - 1] = Vec3(count > 0 ? values[0] : 0, count > 1 ? values[1] : 0, count > 2 ? values[2] : 0, id);
+            *scene->colorsOfVertices[id - 1] = count == 6 ? Color(values[3] * 255, values[4] * 255, values[5] * 255) : Color(255, 255, 255);
+            vertexCount++;
+        }
+        else if (isLine(line, lineEnd, 'f'))
+        {
+            bool valid = true;
+            polygon.clear();
+
+            for (const char *p = skipBlanks(line + 1, lineEnd); p < lineEnd; p = skipBlanks(p, lineEnd))
+            {
+                int index;
+                const char *after = parseInt(p, index);
+                if (after == p)
+                {
+                    valid = false;
+                    break;
+                }
+
+                // skip the texture and normal references
+                while (after < lineEnd && *after != ' ' && *after != '\t' && *after != '\r')
+                    after++;
+                p = after;
+
+                if (index < 0)
+                    index = vertexCount + 1 + index;
+                valid = valid && index >= 1 && index <= fileVertexCount;
+                polygon.push_back(firstId - 1 + index);
+            }
+
+            for (int k = 1; valid && k + 1 < polygon.size(); k++)
+            {
+                piece.triangles.push_back(Triangle(polygon[0], polygon[k], polygon[k + 1]));
+            }
+        }
+    });
+}
+
+/*
+    Runs body on every piece, on the parsing pool when there are several.
+*/
+static void forEachPiece(vector<ObjPiece> &pieces, const function<void(ObjPiece &)> &body)
+{
+    if (pieces.size() == 1)
+    {
+        body(pieces[0]);
+        return;
+    }
+
+    getParsingPool().parallelFor(pieces.size(), [&](int i)
+    {
+        body(pieces[i]);
+    });
+}
+
+/*
+    Two passes over the pieces: the first counts their vertices, so that the second one
+    knows the id of every vertex it reads and can resolve negative references.
+*/
+bool importOBJ(const char *path, Scene *scene, Mesh *mesh)
+{
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    if (file.size == 0)
+        return true;
+
+    const char *text = file.data;
+    const char *end = text + file.size;
+    int threadCount = file.size >= PARALLEL_FACES_MIN_LENGTH ? getParsingPool().size() : 1;
+
+    vector<const char *> bounds;
+    splitRows(text, end, threadCount, bounds);
+    vector<ObjPiece> pieces(threadCount);
+    for (int i = 0; i < threadCount; i++)
+    {
+        pieces[i].begin = bounds[i];
+        pieces[i].end = bounds[i + 1];
+    }
+
+    forEachPiece(pieces, countOBJVertices);
+
+    int fileVertexCount = 0;
+    for (int i = 0; i < threadCount; i++)
+    {
+        pieces[i].firstVertex = fileVertexCount;
+        fileVertexCount += pieces[i].vertexCount;
+    }
+
+    // the arena is not thread safe, the vertices are allocated here and filled by the threads
+    int firstId = scene->vertices.size() + 1;
+    Vec3 *vertices = scene->arena.createArray<Vec3>(fileVertexCount);
+    Color *colors = scene->arena.createArray<Color>(fileVertexCount);
+    for (int i = 0; i < fileVertexCount; i++)
+    {
+        scene->vertices.push_back(&vertices[i]);
+        scene->colorsOfVertices.push_back(&colors[i]);
+    }
+
+    forEachPiece(pieces, [&](ObjPiece &piece)
+    {
+        parseOBJPiece(piece, scene, firstId, fileVertexCount);
+    });
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        mesh->triangles.insert(mesh->triangles.end(), pieces[i].triangles.begin(), pieces[i].triangles.end());
+    }
+    return true;
+}
+
+struct PlyProperty
+{
+    string name;
+    int type;      // size in bytes of a scalar property, PLY_LIST for a list
+    int countType; // sizes of the count and of the items of a list
+    int itemType;
+    bool countSigned;
+    bool isFloat;  // of the scalar or of the list items
+    bool isSigned;
+};
+
+struct PlyElement
+{
+    string name;
+    long long count;
+    vector<PlyProperty> properties;
+};
+
+/*
+    Size in bytes of a PLY type, 0 if unknown. Sets isFloat and isSigned.
+*/
+static int getPlyType(const string &name, bool &isFloat, bool &isSigned)
+{
+    static const char *names[] = {"char", "int8", "uchar", "uint8", "short", "int16", "ushort", "uint16",
+                                  "int", "int32", "uint", "uint32", "float", "float32", "double", "float64"};
+    static const int sizes[] = {1, 1, 1, 1, 2, 2, 2, 2, 4, 4, 4, 4, 4, 4, 8, 8};
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (name == names[i])
+        {
+            isFloat = i >= 12;
+            isSigned = i >= 12 || (i / 2) % 2 == 0;
+            return sizes[i];
+        }
+    }
+    return 0;
+}
+
+static double readPlyValue(const char *p, int size, bool isFloat, bool isSigned, bool swap)
+{
+    unsigned char bytes[8];
+
+    for (int i = 0; i < size; i++)
+    {
+        bytes[i] = p[swap ? size - 1 - i : i];
+    }
+
+    if (size == 1)
+        return isSigned ? (double)(signed char)bytes[0] : (double)bytes[0];
+    if (size == 2)
+    {
+        unsigned short value;
+        memcpy(&value, bytes, 2);
+        return isSigned ? (double)(short)value : (double)value;
+    }
+    if (size == 4 && isFloat)
+    {
+        float value;
+        memcpy(&value, bytes, 4);
+        return value;
+    }
+    if (size == 4)
+    {
+        unsigned int value;
+        memcpy(&value, bytes, 4);
+        return isSigned ? (double)(int)value : (double)value;
+    }
+
+    double value;
+    memcpy(&value, bytes, 8);
+    return value;
+}
+
+/*
+    Reads the header lines up to end_header. Returns the position of the data, or NULL.
+*/
+static const char *readPlyHeader(const char *text, const char *end, bool &bigEndian, vector<PlyElement> &elements)
+{
+    bool binary = false;
+    const char *line = text;
+    int lineNumber = 0;
+
+    while (line < end)
+    {
+        const char *newline = (const char *)memchr(line, '\n', end - line);
+        if (newline == NULL)
+            return NULL;
+
+        string content(line, newline);
+        if (!content.empty() && content[content.size() - 1] == '\r')
+            content.erase(content.size() - 1);
+        line = newline + 1;
+
+        vector<string> words;
+        for (size_t start = 0; start < content.size();)
+        {
+            size_t wordEnd = content.find_first_of(" \t", start);
+            if (wordEnd == string::npos)
+                wordEnd = content.size();
+            if (wordEnd > start)
+                words.push_back(content.substr(start, wordEnd - start));
+            start = wordEnd + 1;
+        }
+
+        if (lineNumber++ == 0)
+        {
+            if (words.size() != 1 || words[0] != "ply")
+                return NULL;
+        }
+        else if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+        {
+            continue;
+        }
+        else if (words[0] == "format" && words.size() >= 2)
+        {
+            binary = words[1] == "binary_little_endian" || words[1] == "binary_big_endian";
+            bigEndian = words[1] == "binary_big_endian";
+        }
+        else if (words[0] == "element" && words.size() == 3)
+        {
+            PlyElement element;
+            element.name = words[1];
+            element.count = atoll(words[2].c_str());
+            elements.push_back(element);
+        }
+        else if (words[0] == "property" && !elements.empty())
+        {
+            PlyProperty property = PlyProperty();
+            bool countFloat;
+
+            if (words.size() == 5 && words[1] == "list")
+            {
+                property.type = PLY_LIST;
+                property.countType = getPlyType(words[2], countFloat, property.countSigned);
+                property.itemType = getPlyType(words[3], property.isFloat, property.isSigned);
+                property.name = words[4];
+                if (property.countType == 0 || property.itemType == 0 || countFloat)
+                    return NULL;
+            }
+            else if (words.size() == 3)
+            {
+                property.type = getPlyType(words[1], property.isFloat, property.isSigned);
+                property.name = words[2];
+                if (property.type == 0)
+                    return NULL;
+            }
+            else
+            {
+                return NULL;
+            }
+            elements.back().properties.push_back(property);
+        }
+        else if (words[0] == "end_header")
+        {
+            // ASCII PLY is not supported
+            return binary ? line : NULL;
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+bool importPLY(const char *path, Scene *scene, Mesh *mesh)
+{
+    MappedFile file;
+    if (!file.open(path) || file.size == 0)
+        return false;
+
+    const char *end = file.data + file.size;
+    bool bigEndian = false;
+    vector<PlyElement> elements;
+    const char *p = readPlyHeader(file.data, end, bigEndian, elements);
+    if (p == NULL)
+        return false;
+
+    unsigned short one = 1;
+    bool swap = bigEndian == (*(unsigned char *)&one == 1);
+    int firstId = scene->vertices.size() + 1;
+    long long fileVertexCount = 0;
+    vector<long long> polygon;
+
+    // from the header, so that faces stored before the vertices are checked against it too
+    for (int e = 0; e < elements.size(); e++)
+    {
+        if (elements[e].name == "vertex")
+            fileVertexCount = elements[e].count;
+    }
+
+    for (int e = 0; e < elements.size(); e++)
+    {
+        PlyElement &element = elements[e];
+        bool isVertex = element.name == "vertex";
+        bool isFace = element.name == "face";
+
+        // where each property goes: x, y, z, red, green, blue, or the face indices
+        vector<int> targets(element.properties.size(), -1);
+        for (int i = 0; i < element.properties.size(); i++)
+        {
+            static const char *vertexNames[] = {"x", "y", "z", "red", "green", "blue"};
+            const string &name = element.properties[i].name;
+
+            for (int k = 0; isVertex && k < 6; k++)
+            {
+                if (name == vertexNames[k])
+                    targets[i] = k;
+            }
+            if (isFace && element.properties[i].type == PLY_LIST && (name == "vertex_indices" || name == "vertex_index"))
+                targets[i] = 6;
+        }
+
+        if (isVertex)
+        {
+            scene->vertices.reserve(firstId - 1 + element.count);
+            scene->colorsOfVertices.reserve(firstId - 1 + element.count);
+        }
+
+        for (long long n = 0; n < element.count; n++)
+        {
+            double values[6] = {0, 0, 0, 255, 255, 255};
+            polygon.clear();
+
+            for (int i = 0; i < element.properties.size(); i++)
+            {
+                PlyProperty &property = element.properties[i];
+
+                if (property.type != PLY_LIST)
+                {
+                    if (end - p < property.type)
+                        return false;
+                    if (targets[i] >= 0)
+                    {
+                        double value = readPlyValue(p, property.type, property.isFloat, property.isSigned, swap);
+                        values[targets[i]] = targets[i] >= 3 && property.isFloat ? value * 255 : value;
+                    }
+                    p += property.type;
+                    continue;
+                }
+
+                if (end - p < property.countType)
+                    return false;
+                long long count = (long long)readPlyValue(p, property.countType, false, property.countSigned, swap);
+                p += property.countType;
+                if (count < 0 || count > (end - p) / property.itemType)
+                    return false;
+
+                for (long long k = 0; targets[i] == 6 && k < count; k++)
+                {
+                    polygon.push_back((long long)readPlyValue(p + k * property.itemType, property.itemType, false, property.isSigned, swap));
+                }
+                p += count * property.itemType;
+            }
+
+            if (isVertex)
+            {
+                int id = scene->vertices.size() + 1;
+                scene->vertices.push_back(scene->arena.create<Vec3>(values[0], values[1], values[2], id));
+                scene->colorsOfVertices.push_back(scene->arena.create<Color>(values[3], values[4], values[5]));
+            }
+            else if (isFace)
+            {
+                bool valid = true;
+                for (int k = 0; k < polygon.size(); k++)
+                {
+                    valid = valid && polygon[k] >= 0 && polygon[k] < fileVertexCount;
+                }
+                for (int k = 1; valid && k + 1 < polygon.size(); k++)
+                {
+                    mesh->triangles.push_back(Triangle(firstId + polygon[0], firstId + polygon[k], firstId + polygon[k + 1]));
+                }
+            }
+        }
+    }
+    return true;
+}
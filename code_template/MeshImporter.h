@@ -0,0 +1,31 @@
+#ifndef __MESH_IMPORTER_H__
+#define __MESH_IMPORTER_H__
+
+class Scene;
+class Mesh;
+
+/*
+    Importers of meshes stored in other formats. The vertices of the file are added after
+    the scene's vertices and colorsOfVertices, and its faces to the mesh's triangles with
+    the vertex ids moved accordingly. Polygons are split into triangle fans, vertices
+    without a color are white and faces using a vertex the file does not have are
+    skipped. Both return false when the file can not be read.
+*/
+
+/*
+    Wavefront OBJ. Reads "v x y z" lines, optionally followed by "r g b" in [0, 1], and
+    "f" lines of v, v/vt, v//vn or v/vt/vn references, negative ones counting back from
+    the last vertex. Other lines are ignored. Files longer than PARALLEL_FACES_MIN_LENGTH
+    are split on line boundaries and parsed on several threads.
+*/
+bool importOBJ(const char *path, Scene *scene, Mesh *mesh);
+
+/*
+    Binary PLY in either byte order, read from the memory-mapped file. Reads the x, y, z
+    and red, green, blue properties of the vertex element and the vertex_indices (or
+    vertex_index) list of the face element, everything else is skipped. Integer colors
+    are in [0, 255], floating point ones in [0, 1].
+*/
+bool importPLY(const char *path, Scene *scene, Mesh *mesh);
+
+#endif
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include "OutOfCoreRenderer.h"
+
+using namespace std;
+
+OutOfCoreRenderer::OutOfCoreRenderer(Scene *scene)
+{
+    this->scene = scene;
+    this->firstTouchedVertex = UINT32_MAX;
+    this->lastTouchedVertex = 0;
+}
+
+bool OutOfCoreRenderer::open(const char *cachePath)
+{
+    if (!this->cache.open(cachePath) || !this->cache.readSceneData(this->scene))
+    {
+        return false;
+    }
+
+    this->meshes.resize(this->cache.header->meshCount);
+    for (int i = 0; i < this->meshes.size(); i++)
+    {
+        if (!this->cache.readMeshHeader(i, &this->meshes[i]))
+        {
+            return false;
+        }
+
+        // the ids have been checked, their pages are read again when the mesh is drawn
+        const SceneCacheMesh &record = this->cache.meshes[i];
+        this->cache.file.release(this->cache.file.data + record.indicesOffset, (size_t)record.triangleCount * 3 * sizeof(uint32_t));
+        this->cache.file.release(this->cache.file.data + record.edgesOffset, (size_t)record.edgeCount * 4 * sizeof(int32_t));
+    }
+    return true;
+}
+
+/*
+    Same as Scene::getTransformedVertex, reading the position from the cache.
+*/
+Vec4 OutOfCoreRenderer::getTransformedVertex(uint32_t vertexId, Matrix4 &transformationMatrix)
+{
+    this->firstTouchedVertex = min(this->firstTouchedVertex, vertexId);
+    this->lastTouchedVertex = max(this->lastTouchedVertex, vertexId);
+
+    const double **positions = this->cache.positions;
+    Vec4 vertex(positions[0][vertexId - 1], positions[1][vertexId - 1], positions[2][vertexId - 1], 1);
+    Vec4 transformed_vertex = multiplyMatrixWithVec4(transformationMatrix, vertex);
+
+    transformed_vertex.x /= transformed_vertex.t;
+    transformed_vertex.y /= transformed_vertex.t;
+    transformed_vertex.z /= transformed_vertex.t;
+    transformed_vertex.t = 1;
+
+    return transformed_vertex;
+}
+
+Color OutOfCoreRenderer::getColor(uint32_t vertexId)
+{
+    const double **colors = this->cache.colors;
+    return Color(colors[0][vertexId - 1], colors[1][vertexId - 1], colors[2][vertexId - 1]);
+}
+
+/*
+    Gives back the pages of the chunk's indices and of the vertex range it read.
+*/
+void OutOfCoreRenderer::releaseChunk(const void *indices, size_t size)
+{
+    MappedFile &file = this->cache.file;
+    file.release(indices, size);
+
+    if (this->firstTouchedVertex <= this->lastTouchedVertex)
+    {
+        size_t begin = this->firstTouchedVertex - 1;
+        size_t count = this->lastTouchedVertex - this->firstTouchedVertex + 1;
+
+        for (int k = 0; k < 3; k++)
+        {
+            file.release(this->cache.positions[k] + begin, count * sizeof(double));
+            file.release(this->cache.colors[k] + begin, count * sizeof(double));
+        }
+    }
+    this->firstTouchedVertex = UINT32_MAX;
+    this->lastTouchedVertex = 0;
+}
+
+void OutOfCoreRenderer::renderSolidMesh(int meshIndex, Matrix4 &transformationMatrix, FrameBuffer &frameBuffer)
+{
+    const SceneCacheMesh &record = this->cache.meshes[meshIndex];
+    const uint32_t *indices = (const uint32_t *)(this->cache.file.data + record.indicesOffset);
+    Region image(0, 0, frameBuffer.width - 1, frameBuffer.height - 1);
+
+    for (int begin = 0; begin < record.triangleCount; begin += OUT_OF_CORE_CHUNK_SIZE)
+    {
+        int end = min(begin + OUT_OF_CORE_CHUNK_SIZE, record.triangleCount);
+
+        for (int i = begin; i < end; i++)
+        {
+            ScreenTriangle screenTriangle;
+
+            for (int k = 0; k < 3; k++)
+            {
+                screenTriangle.vertices[k] = getTransformedVertex(indices[i * 3 + k], transformationMatrix);
+                screenTriangle.colors[k] = getColor(indices[i * 3 + k]);
+            }
+            if (this->scene->setupTransformedTriangle(this->viewportTransformationMatrix, frameBuffer.width, frameBuffer.height, screenTriangle))
+            {
+                this->scene->rasterizeTriangle(screenTriangle, frameBuffer, image);
+            }
+        }
+        releaseChunk(indices + begin * 3, (end - begin) * 3 * sizeof(uint32_t));
+    }
+}
+
+/*
+    Same as Scene::processWireframeMesh: a first pass over the triangles computes the
+    back face flags when culling is enabled, a second one draws the edges.
+*/
+void OutOfCoreRenderer::renderWireframeMesh(int meshIndex, Matrix4 &transformationMatrix, FrameBuffer &frameBuffer)
+{
+    const SceneCacheMesh &record = this->cache.meshes[meshIndex];
+    const uint32_t *indices = (const uint32_t *)(this->cache.file.data + record.indicesOffset);
+    const int32_t *edges = (const int32_t *)(this->cache.file.data + record.edgesOffset);
+
+    this->frontFacing.clear();
+    if (this->scene->cullingEnabled)
+    {
+        this->frontFacing.resize(record.triangleCount);
+
+        for (int begin = 0; begin < record.triangleCount; begin += OUT_OF_CORE_CHUNK_SIZE)
+        {
+            int end = min(begin + OUT_OF_CORE_CHUNK_SIZE, record.triangleCount);
+
+            for (int i = begin; i < end; i++)
+            {
+                Vec4 transformed_vertex_0 = getTransformedVertex(indices[i * 3], transformationMatrix);
+                Vec4 transformed_vertex_1 = getTransformedVertex(indices[i * 3 + 1], transformationMatrix);
+                Vec4 transformed_vertex_2 = getTransformedVertex(indices[i * 3 + 2], transformationMatrix);
+                this->frontFacing[i] = !this->scene->isBackFacing(transformed_vertex_0, transformed_vertex_1, transformed_vertex_2);
+            }
+            releaseChunk(indices + begin * 3, (end - begin) * 3 * sizeof(uint32_t));
+        }
+    }
+
+    LineBatch batch;
+    for (int begin = 0; begin < record.edgeCount; begin += OUT_OF_CORE_CHUNK_SIZE)
+    {
+        int end = min(begin + OUT_OF_CORE_CHUNK_SIZE, record.edgeCount);
+
+        for (int i = begin; i < end; i++)
+        {
+            Edge edge;
+            edge.vertexIds[0] = edges[i * 4];
+            edge.vertexIds[1] = edges[i * 4 + 1];
+            edge.triangleIds[0] = edges[i * 4 + 2];
+            edge.triangleIds[1] = edges[i * 4 + 3];
+
+            if (!this->scene->isEdgeVisible(edge, this->frontFacing))
+                continue;
+
+            Vec4 transformed_vertex_0 = getTransformedVertex(edge.vertexIds[0], transformationMatrix);
+            Vec4 transformed_vertex_1 = getTransformedVertex(edge.vertexIds[1], transformationMatrix);
+            Color color_0 = getColor(edge.vertexIds[0]);
+            Color color_1 = getColor(edge.vertexIds[1]);
+            batch.add(transformed_vertex_0, transformed_vertex_1, color_0, color_1);
+
+            if (batch.isFull())
+            {
+                this->scene->rasterizeLineBatch(batch, this->viewportTransformationMatrix, frameBuffer);
+            }
+        }
+        releaseChunk(edges + begin * 4, (end - begin) * 4 * sizeof(int32_t));
+    }
+    this->scene->rasterizeLineBatch(batch, this->viewportTransformationMatrix, frameBuffer);
+
+    // the flags are only needed for this mesh
+    vector<char>().swap(this->frontFacing);
+}
+
+void OutOfCoreRenderer::render(Camera *camera, FrameBuffer &frameBuffer)
+{
+    frameBuffer.resize(camera->horRes, camera->verRes);
+    frameBuffer.clearDepth();
+
+    this->viewportTransformationMatrix = camera->getViewportTransformationMatrix();
+
+    for (int i = 0; i < this->meshes.size(); i++)
+    {
+        Matrix4 transformationMatrix = this->scene->getTransformationMatrix(&this->meshes[i], camera);
+
+        if (this->meshes[i].type == WIREFRAME_MESH)
+            renderWireframeMesh(i, transformationMatrix, frameBuffer);
+        else
+            renderSolidMesh(i, transformationMatrix, frameBuffer);
+    }
+}
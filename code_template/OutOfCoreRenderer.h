@@ -0,0 +1,43 @@
+#ifndef __OUT_OF_CORE_RENDERER_H__
+#define __OUT_OF_CORE_RENDERER_H__
+#define OUT_OF_CORE_CHUNK_SIZE 65536
+#include <vector>
+#include "Scene.h"
+#include "SceneCache.h"
+
+/*
+    Renders a scene straight from its memory-mapped cache file, for scenes that do not
+    fit in memory. Triangles and edges are read in chunks of OUT_OF_CORE_CHUNK_SIZE,
+    transformed, culled and rasterized, then the pages of the chunk's indices and of
+    the vertices it read are given back to the system. Only the frame buffer, the
+    cameras, the transformation tables and, for culled wireframe meshes, one back face
+    flag per triangle stay in memory. The image is identical to the one of
+    Scene::forwardRenderingPipeline.
+*/
+class OutOfCoreRenderer
+{
+public:
+    Scene *scene;
+    SceneCacheFile cache;
+
+    OutOfCoreRenderer(Scene *scene);
+
+    // maps the cache file and reads its settings, cameras and transformations into the scene
+    bool open(const char *cachePath);
+
+    void render(Camera *camera, FrameBuffer &frameBuffer);
+
+private:
+    std::vector<Mesh> meshes; // modeling transformations of the meshes, without their triangles and edges
+    std::vector<char> frontFacing;
+    Matrix4 viewportTransformationMatrix;
+    uint32_t firstTouchedVertex, lastTouchedVertex; // ids of the vertices read since the last release
+
+    Vec4 getTransformedVertex(uint32_t vertexId, Matrix4 &transformationMatrix);
+    Color getColor(uint32_t vertexId);
+    void renderSolidMesh(int meshIndex, Matrix4 &transformationMatrix, FrameBuffer &frameBuffer);
+    void renderWireframeMesh(int meshIndex, Matrix4 &transformationMatrix, FrameBuffer &frameBuffer);
+    void releaseChunk(const void *indices, size_t size);
+};
+
+#endif
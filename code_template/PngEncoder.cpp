@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstdlib>
+#include "PngEncoder.h"
+
+using namespace std;
+
+/*
+    CRC-32 table of the PNG chunk checksum.
+*/
+class CrcTable
+{
+public:
+    unsigned values[256];
+
+    CrcTable()
+    {
+        for (unsigned n = 0; n < 256; n++)
+        {
+            unsigned c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            values[n] = c;
+        }
+    }
+};
+
+static const CrcTable crcTable;
+
+static unsigned updateCrc(unsigned crc, const unsigned char *data, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        crc = crcTable.values[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void putBigEndian(unsigned char *p, unsigned value)
+{
+    p[0] = value >> 24;
+    p[1] = (value >> 16) & 0xff;
+    p[2] = (value >> 8) & 0xff;
+    p[3] = value & 0xff;
+}
+
+static inline unsigned char paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+
+    if (pa <= pb && pa <= pc)
+        return a;
+    if (pb <= pc)
+        return b;
+    return c;
+}
+
+PngEncoder::PngEncoder()
+{
+    this->out = NULL;
+    this->width = 0;
+    this->height = 0;
+}
+
+void PngEncoder::writeChunk(const char *type, const unsigned char *data, int size)
+{
+    unsigned char header[8];
+    unsigned char footer[4];
+
+    putBigEndian(header, size);
+    for (int i = 0; i < 4; i++)
+    {
+        header[4 + i] = type[i];
+    }
+    unsigned crc = updateCrc(0xffffffffu, header + 4, 4);
+    crc = updateCrc(crc, data, size) ^ 0xffffffffu;
+    putBigEndian(footer, crc);
+
+    this->out->write((const char *)header, 8);
+    this->out->write((const char *)data, size);
+    this->out->write((const char *)footer, 4);
+}
+
+void PngEncoder::begin(ostream &out, int width, int height)
+{
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    unsigned char header[13];
+
+    this->out = &out;
+    this->width = width;
+    this->height = height;
+    this->previousRow.assign(width * 3, 0);
+    this->filtered.resize(5 * (width * 3 + 1));
+    this->deflater.output.clear();
+
+    putBigEndian(header, width);
+    putBigEndian(header + 4, height);
+    header[8] = 8;  // bit depth
+    header[9] = 2;  // RGB
+    header[10] = 0; // deflate
+    header[11] = 0; // adaptive filtering
+    header[12] = 0; // no interlace
+
+    out.write((const char *)signature, 8);
+    writeChunk("IHDR", header, 13);
+}
+
+/*
+    Filters the row with all five PNG filters and passes the one with the smallest sum of
+    absolute values, taken as signed bytes, to the compressor. This is the usual heuristic,
+    it is done in a single pass over the row.
+*/
+void PngEncoder::filterRow(const unsigned char *row)
+{
+    int stride = this->width * 3 + 1;
+    const unsigned char *up = &this->previousRow[0];
+    unsigned char *none = &this->filtered[0];
+    unsigned char *sub = none + stride;
+    unsigned char *upFiltered = sub + stride;
+    unsigned char *average = upFiltered + stride;
+    unsigned char *paethFiltered = average + stride;
+    long sums[5] = {0, 0, 0, 0, 0};
+
+    none[0] = 0;
+    sub[0] = 1;
+    upFiltered[0] = 2;
+    average[0] = 3;
+    paethFiltered[0] = 4;
+
+    for (int i = 0; i < this->width * 3; i++)
+    {
+        int a = i >= 3 ? row[i - 3] : 0;
+        int b = up[i];
+        int c = i >= 3 ? up[i - 3] : 0;
+        int x = row[i];
+
+        none[i + 1] = x;
+        sub[i + 1] = x - a;
+        upFiltered[i + 1] = x - b;
+        average[i + 1] = x - ((a + b) >> 1);
+        paethFiltered[i + 1] = x - paeth(a, b, c);
+
+        sums[0] += abs((signed char)none[i + 1]);
+        sums[1] += abs((signed char)sub[i + 1]);
+        sums[2] += abs((signed char)upFiltered[i + 1]);
+        sums[3] += abs((signed char)average[i + 1]);
+        sums[4] += abs((signed char)paethFiltered[i + 1]);
+    }
+
+    int best = 0;
+    for (int i = 1; i < 5; i++)
+    {
+        if (sums[i] < sums[best])
+            best = i;
+    }
+    this->deflater.write(none + best * stride, stride);
+}
+
+/*
+    Moves compressed data into IDAT chunks, all of it or only full chunks.
+*/
+void PngEncoder::writeCompressed(bool all)
+{
+    vector<unsigned char> &data = this->deflater.output;
+    int written = 0;
+
+    while (data.size() - written >= PNG_IDAT_SIZE || (all && written < data.size()))
+    {
+        int size = min((int)data.size() - written, PNG_IDAT_SIZE);
+        writeChunk("IDAT", &data[written], size);
+        written += size;
+    }
+    data.erase(data.begin(), data.begin() + written);
+}
+
+void PngEncoder::writeRows(const unsigned char *pixels, int rowCount)
+{
+    int rowSize = this->width * 3;
+
+    for (int i = 0; i < rowCount; i++)
+    {
+        const unsigned char *row = pixels + i * rowSize;
+        filterRow(row);
+        this->previousRow.assign(row, row + rowSize);
+    }
+    writeCompressed(false);
+}
+
+void PngEncoder::finish()
+{
+    this->deflater.finish();
+    writeCompressed(true);
+    writeChunk("IEND", NULL, 0);
+}
@@ -0,0 +1,35 @@
+#ifndef __PNG_ENCODER_H__
+#define __PNG_ENCODER_H__
+#define PNG_IDAT_SIZE 65536
+#include <ostream>
+#include <vector>
+#include "Deflater.h"
+
+/*
+    Streaming encoder of 8-bit RGB PNG images. Rows are passed top row first, in any
+    number of calls, and written to the stream as soon as their compressed data fills
+    an IDAT chunk.
+*/
+class PngEncoder
+{
+public:
+    PngEncoder();
+
+    void begin(std::ostream &out, int width, int height);
+    // rows of width * 3 bytes each
+    void writeRows(const unsigned char *pixels, int rowCount);
+    void finish();
+
+private:
+    std::ostream *out;
+    int width, height;
+    std::vector<unsigned char> previousRow;
+    std::vector<unsigned char> filtered; // filter type followed by the filtered row, for each of the five filters
+    Deflater deflater;
+
+    void writeChunk(const char *type, const unsigned char *data, int size);
+    void writeCompressed(bool all);
+    void filterRow(const unsigned char *row);
+};
+
+#endif
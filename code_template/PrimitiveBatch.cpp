@@ -0,0 +1,12 @@
+#include "PrimitiveBatch.h"
+
+PrimitiveBatch::PrimitiveBatch()
+{
+    this->meshType = SOLID_MESH;
+    this->count = 0;
+}
+
+bool PrimitiveBatch::isFull()
+{
+    return this->count == PRIMITIVE_BATCH_SIZE;
+}
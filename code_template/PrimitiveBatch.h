@@ -0,0 +1,25 @@
+#ifndef __PRIMITIVE_BATCH_H__
+#define __PRIMITIVE_BATCH_H__
+#define PRIMITIVE_BATCH_SIZE 64
+#include "Mesh.h"
+#include "ScreenTriangle.h"
+#include "ScreenLine.h"
+
+/*
+    Set up primitives passed from a geometry thread to a raster thread. A batch holds
+    either triangles or lines, depending on the type of the mesh they come from.
+*/
+class PrimitiveBatch
+{
+public:
+    int meshType; // SOLID_MESH for triangles, WIREFRAME_MESH for lines
+    int count;
+    ScreenTriangle triangles[PRIMITIVE_BATCH_SIZE];
+    ScreenLine lines[PRIMITIVE_BATCH_SIZE];
+
+    PrimitiveBatch();
+
+    bool isFull();
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include <cstring>
+#include "QoiEncoder.h"
+
+using namespace std;
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+
+static void putBigEndian(vector<unsigned char> &buffer, unsigned value)
+{
+    buffer.push_back(value >> 24);
+    buffer.push_back((value >> 16) & 0xff);
+    buffer.push_back((value >> 8) & 0xff);
+    buffer.push_back(value & 0xff);
+}
+
+QoiEncoder::QoiEncoder()
+{
+    this->out = NULL;
+    this->width = 0;
+    this->height = 0;
+    this->run = 0;
+}
+
+void QoiEncoder::begin(ostream &out, int width, int height)
+{
+    this->out = &out;
+    this->width = width;
+    this->height = height;
+    this->run = 0;
+    memset(this->index, 0, sizeof(this->index));
+    memset(this->previous, 0, sizeof(this->previous));
+
+    this->buffer.clear();
+    this->buffer.reserve(QOI_BUFFER_SIZE + 16);
+    this->buffer.push_back('q');
+    this->buffer.push_back('o');
+    this->buffer.push_back('i');
+    this->buffer.push_back('f');
+    putBigEndian(this->buffer, width);
+    putBigEndian(this->buffer, height);
+    this->buffer.push_back(3); // RGB
+    this->buffer.push_back(0); // sRGB with linear alpha
+}
+
+void QoiEncoder::flush()
+{
+    this->out->write((const char *)&this->buffer[0], this->buffer.size());
+    this->buffer.clear();
+}
+
+/*
+    Every pixel is alpha 255, so the alpha part of the hash is the constant 255 * 11.
+*/
+void QoiEncoder::writeRows(const unsigned char *pixels, int rowCount)
+{
+    int count = rowCount * this->width;
+
+    for (int i = 0; i < count; i++)
+    {
+        const unsigned char *pixel = pixels + i * 3;
+        unsigned char r = pixel[0], g = pixel[1], b = pixel[2];
+
+        if (r == this->previous[0] && g == this->previous[1] && b == this->previous[2])
+        {
+            this->run++;
+            if (this->run == 62)
+            {
+                this->buffer.push_back(QOI_OP_RUN | (this->run - 1));
+                this->run = 0;
+            }
+            continue;
+        }
+
+        if (this->run > 0)
+        {
+            this->buffer.push_back(QOI_OP_RUN | (this->run - 1));
+            this->run = 0;
+        }
+
+        int slot = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+        if (this->index[slot][0] == r && this->index[slot][1] == g && this->index[slot][2] == b && this->index[slot][3] == 255)
+        {
+            this->buffer.push_back(QOI_OP_INDEX | slot);
+        }
+        else
+        {
+            this->index[slot][0] = r;
+            this->index[slot][1] = g;
+            this->index[slot][2] = b;
+            this->index[slot][3] = 255;
+
+            signed char dr = r - this->previous[0];
+            signed char dg = g - this->previous[1];
+            signed char db = b - this->previous[2];
+            signed char drg = dr - dg;
+            signed char dbg = db - dg;
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+            {
+                this->buffer.push_back(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+            }
+            else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+            {
+                this->buffer.push_back(QOI_OP_LUMA | (dg + 32));
+                this->buffer.push_back((drg + 8) << 4 | (dbg + 8));
+            }
+            else
+            {
+                this->buffer.push_back(QOI_OP_RGB);
+                this->buffer.push_back(r);
+                this->buffer.push_back(g);
+                this->buffer.push_back(b);
+            }
+        }
+
+        this->previous[0] = r;
+        this->previous[1] = g;
+        this->previous[2] = b;
+
+        if (this->buffer.size() >= QOI_BUFFER_SIZE)
+        {
+            flush();
+        }
+    }
+}
+
+void QoiEncoder::finish()
+{
+    static const unsigned char padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+    if (this->run > 0)
+    {
+        this->buffer.push_back(QOI_OP_RUN | (this->run - 1));
+        this->run = 0;
+    }
+    this->buffer.insert(this->buffer.end(), padding, padding + 8);
+    flush();
+}
@@ -0,0 +1,32 @@
+#ifndef __QOI_ENCODER_H__
+#define __QOI_ENCODER_H__
+#define QOI_BUFFER_SIZE 65536
+#include <ostream>
+#include <vector>
+
+/*
+    Streaming encoder of RGB images in the QOI ("Quite OK Image") format.
+    Rows are passed top row first, in any number of calls.
+*/
+class QoiEncoder
+{
+public:
+    QoiEncoder();
+
+    void begin(std::ostream &out, int width, int height);
+    // rows of width * 3 bytes each
+    void writeRows(const unsigned char *pixels, int rowCount);
+    void finish();
+
+private:
+    std::ostream *out;
+    int width, height;
+    unsigned char index[64][4]; // recently seen pixels by hash, RGBA with alpha 0 in unused slots
+    unsigned char previous[3];
+    int run;
+    std::vector<unsigned char> buffer;
+
+    void flush();
+};
+
+#endif
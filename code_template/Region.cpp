@@ -0,0 +1,59 @@
+#include <algorithm>
+#include "Region.h"
+
+Region::Region()
+{
+    this->xMin = 0;
+    this->yMin = 0;
+    this->xMax = -1;
+    this->yMax = -1;
+}
+
+Region::Region(int xMin, int yMin, int xMax, int yMax)
+{
+    this->xMin = xMin;
+    this->yMin = yMin;
+    this->xMax = xMax;
+    this->yMax = yMax;
+}
+
+Region::Region(const Region &other)
+{
+    this->xMin = other.xMin;
+    this->yMin = other.yMin;
+    this->xMax = other.xMax;
+    this->yMax = other.yMax;
+}
+
+bool Region::isEmpty()
+{
+    return this->xMin > this->xMax || this->yMin > this->yMax;
+}
+
+bool Region::intersects(Region &other)
+{
+    return !isEmpty() && !other.isEmpty() &&
+           this->xMin <= other.xMax && other.xMin <= this->xMax &&
+           this->yMin <= other.yMax && other.yMin <= this->yMax;
+}
+
+void Region::add(Region &other)
+{
+    if (other.isEmpty())
+        return;
+    if (isEmpty())
+    {
+        *this = other;
+        return;
+    }
+    this->xMin = std::min(this->xMin, other.xMin);
+    this->yMin = std::min(this->yMin, other.yMin);
+    this->xMax = std::max(this->xMax, other.xMax);
+    this->yMax = std::max(this->yMax, other.yMax);
+}
+
+std::ostream &operator<<(std::ostream &os, const Region &r)
+{
+    os << "Region [" << r.xMin << ", " << r.xMax << "] x [" << r.yMin << ", " << r.yMax << "]";
+    return os;
+}
@@ -0,0 +1,24 @@
+#ifndef __REGION_H__
+#define __REGION_H__
+#include <iostream>
+
+/*
+    Rectangle of pixels, bounds are inclusive.
+*/
+class Region
+{
+public:
+    int xMin, yMin, xMax, yMax;
+
+    Region();
+    Region(int xMin, int yMin, int xMax, int yMax);
+    Region(const Region &other);
+
+    bool isEmpty();
+    bool intersects(Region &other);
+    // grows the region to the bounding box of both regions
+    void add(Region &other);
+    friend std::ostream &operator<<(std::ostream &os, const Region &r);
+};
+
+#endif
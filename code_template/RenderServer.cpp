@@ -0,0 +1,431 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include "RenderServer.h"
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int signal)
+{
+    stopRequested = 1;
+}
+
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+ResidentScene::ResidentScene()
+{
+    this->scene = NULL;
+    this->renderer = NULL;
+    this->lastUse = 0;
+}
+
+void ResidentScene::release()
+{
+    for (map<int, IncrementalRenderer *>::iterator it = this->incrementalRenderers.begin(); it != this->incrementalRenderers.end(); ++it)
+    {
+        delete it->second;
+    }
+    this->incrementalRenderers.clear();
+    delete this->renderer;
+    delete this->scene;
+    this->renderer = NULL;
+    this->scene = NULL;
+}
+
+/*
+    Checks a "translation", "scaling" or "rotation" request field against the scene,
+    and applies it when apply is set.
+*/
+static bool changeTransformation(Scene *scene, const string &type, const string &value, bool apply, string &error)
+{
+    istringstream fields(value);
+    int id;
+    double values[4];
+    int count = type == "rotation" ? 4 : 3;
+
+    fields >> id;
+    for (int i = 0; i < count; i++)
+        fields >> values[i];
+    if (fields.fail())
+    {
+        error = "invalid " + type + " " + value;
+        return false;
+    }
+
+    int size = type == "translation" ? scene->translations.size() : type == "scaling" ? scene->scalings.size() : scene->rotations.size();
+    if (id < 1 || id > size)
+    {
+        error = "no " + type + " " + to_string(id);
+        return false;
+    }
+
+    if (apply)
+        scene->setTransformation(type[0], id, values);
+    return true;
+}
+
+RenderServer::RenderServer(ThreadPool *pool)
+{
+    this->pool = pool;
+    this->listener = -1;
+    this->useCount = 0;
+}
+
+RenderServer::~RenderServer()
+{
+    for (map<string, ResidentScene>::iterator it = this->scenes.begin(); it != this->scenes.end(); ++it)
+    {
+        it->second.release();
+    }
+#ifndef _WIN32
+    if (this->listener >= 0)
+    {
+        close(this->listener);
+    }
+#endif
+}
+
+bool RenderServer::listen(const char *socketPath)
+{
+#ifndef _WIN32
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        cerr << "Socket path too long: " << socketPath << endl;
+        return false;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    this->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (this->listener < 0)
+    {
+        perror("socket");
+        return false;
+    }
+
+    // a socket file nobody accepts on is left over from a server that did not exit cleanly
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0 && connect(probe, (sockaddr *)&address, sizeof(address)) != 0)
+    {
+        unlink(socketPath);
+    }
+    if (probe >= 0)
+    {
+        close(probe);
+    }
+
+    if (bind(this->listener, (sockaddr *)&address, sizeof(address)) != 0 || ::listen(this->listener, 16) != 0)
+    {
+        perror(socketPath);
+        return false;
+    }
+    this->socketPath = socketPath;
+    return true;
+#else
+    cerr << "--serve needs Unix domain sockets, which this platform does not have" << endl;
+    return false;
+#endif
+}
+
+void RenderServer::run()
+{
+#ifndef _WIN32
+    // no SA_RESTART, so that poll returns when the signal arrives
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    vector<pollfd> descriptors(1);
+    vector<string> pending(1); // received text not forming a whole request yet, per client
+    descriptors[0].fd = this->listener;
+    descriptors[0].events = POLLIN;
+
+    while (!stopRequested)
+    {
+        if (poll(&descriptors[0], descriptors.size(), -1) < 0)
+            continue;
+
+        for (int i = descriptors.size() - 1; i >= 1; i--)
+        {
+            if (descriptors[i].revents == 0)
+                continue;
+
+            char buffer[4096];
+            ssize_t received = recv(descriptors[i].fd, buffer, sizeof(buffer), 0);
+            bool closing = received <= 0;
+
+            if (received > 0)
+            {
+                for (int k = 0; k < received; k++)
+                {
+                    if (buffer[k] != '\r')
+                        pending[i] += buffer[k];
+                }
+
+                size_t end;
+                while ((end = pending[i].find("\n\n")) != string::npos)
+                {
+                    string reply = handleRequest(pending[i].substr(0, end + 1)) + "\n";
+                    pending[i].erase(0, end + 2);
+                    send(descriptors[i].fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+                }
+                if (pending[i].size() > RENDER_SERVER_MAX_REQUEST)
+                {
+                    const char *reply = "error request too long\n";
+                    send(descriptors[i].fd, reply, strlen(reply), MSG_NOSIGNAL);
+                    closing = true;
+                }
+            }
+
+            if (closing)
+            {
+                close(descriptors[i].fd);
+                descriptors.erase(descriptors.begin() + i);
+                pending.erase(pending.begin() + i);
+            }
+        }
+
+        if (descriptors[0].revents & POLLIN)
+        {
+            int client = accept(this->listener, NULL, NULL);
+            if (client >= 0)
+            {
+                pollfd descriptor;
+                descriptor.fd = client;
+                descriptor.events = POLLIN;
+                descriptor.revents = 0;
+                descriptors.push_back(descriptor);
+                pending.push_back(string());
+            }
+        }
+    }
+
+    for (int i = 1; i < descriptors.size(); i++)
+    {
+        close(descriptors[i].fd);
+    }
+    unlink(this->socketPath.c_str());
+#endif
+}
+
+/*
+    Renders the cameras the request asks for and returns the reply line.
+*/
+string RenderServer::handleRequest(const string &request)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    istringstream lines(request);
+    string line, scenePath, output;
+    vector<int> cameraIds;
+    vector<pair<string, string> > changes;
+    bool incremental = false;
+    int format = OUTPUT_BY_EXTENSION;
+
+    while (getline(lines, line))
+    {
+        if (line.empty())
+            continue;
+
+        size_t space = line.find(' ');
+        string key = line.substr(0, space);
+        string value = space == string::npos ? string() : line.substr(space + 1);
+
+        if (key == "scene")
+            scenePath = value;
+        else if (key == "output")
+            output = value;
+        else if (key == "cameras")
+        {
+            istringstream ids(value);
+            int id;
+            while (ids >> id)
+                cameraIds.push_back(id);
+            if (!ids.eof())
+                return "error invalid camera id list: " + value;
+        }
+        else if (key == "translation" || key == "scaling" || key == "rotation")
+            changes.push_back(make_pair(key, value));
+        else if (key == "incremental")
+            incremental = true;
+        else if (key == "format")
+        {
+            if (value == "p3")
+                format = OUTPUT_PPM_ASCII;
+            else if (value == "p6")
+                format = OUTPUT_PPM_BINARY;
+            else if (value == "png")
+                format = OUTPUT_PNG;
+            else if (value == "qoi")
+                format = OUTPUT_QOI;
+            else
+                return "error unknown format " + value;
+        }
+        else
+            return "error unknown field " + key;
+    }
+
+    if (scenePath.empty())
+        return "error no scene given";
+
+    bool cached;
+    string error;
+    ResidentScene *resident = getScene(scenePath, cached, error);
+    if (resident == NULL)
+        return "error " + error;
+    double loadTime = millisecondsSince(start);
+
+    // the whole request is checked before any change is applied, so a rejected
+    // request leaves the resident scene as it was
+    Scene *scene = resident->scene;
+    for (int i = 0; i < changes.size(); i++)
+    {
+        if (!changeTransformation(scene, changes[i].first, changes[i].second, false, error))
+            return "error " + error;
+    }
+
+    vector<Camera *> cameras;
+    if (cameraIds.empty())
+        cameras = scene->cameras;
+    for (int i = 0; i < cameraIds.size(); i++)
+    {
+        Camera *camera = NULL;
+        for (int j = 0; j < scene->cameras.size() && camera == NULL; j++)
+        {
+            if (scene->cameras[j]->cameraId == cameraIds[i])
+                camera = scene->cameras[j];
+        }
+        if (camera == NULL)
+            return "error no camera " + to_string(cameraIds[i]) + " in " + scenePath;
+        cameras.push_back(camera);
+    }
+    if (cameras.size() > 1 && !output.empty() && output.find("%d") == string::npos)
+        return "error output needs %d to name the images of several cameras";
+
+    for (int i = 0; i < changes.size(); i++)
+    {
+        changeTransformation(scene, changes[i].first, changes[i].second, true, error);
+    }
+    if (!changes.empty())
+        scene->updateModelingTransformations();
+
+    double renderTime = 0, writeTime = 0;
+    long long redrawnPixels = 0;
+    scene->outputFormat = format;
+
+    for (int i = 0; i < cameras.size(); i++)
+    {
+        // a copy, so that the output file of the scene's camera stays as loaded
+        Camera camera(*cameras[i]);
+        if (!output.empty())
+        {
+            camera.outputFilename = output;
+            size_t placeholder = output.find("%d");
+            if (placeholder != string::npos)
+                camera.outputFilename.replace(placeholder, 2, to_string(camera.cameraId));
+        }
+
+        chrono::steady_clock::time_point renderStart = chrono::steady_clock::now();
+        FrameBuffer *frameBuffer = &this->frameBuffer;
+        if (incremental)
+        {
+            IncrementalRenderer *&renderer = resident->incrementalRenderers[camera.cameraId];
+            if (renderer == NULL)
+                renderer = new IncrementalRenderer(scene);
+
+            Region redrawn = renderer->render(&camera);
+            if (!redrawn.isEmpty())
+                redrawnPixels += (long long)(redrawn.xMax - redrawn.xMin + 1) * (redrawn.yMax - redrawn.yMin + 1);
+            frameBuffer = &renderer->frameBuffer;
+        }
+        else
+        {
+            scene->initializeImage(&camera, *frameBuffer);
+            resident->renderer->render(&camera, *frameBuffer);
+            redrawnPixels += (long long)camera.horRes * camera.verRes;
+        }
+
+        chrono::steady_clock::time_point writeStart = chrono::steady_clock::now();
+        scene->writeImage(&camera, *frameBuffer, this->pool);
+
+        renderTime += chrono::duration<double, milli>(writeStart - renderStart).count();
+        writeTime += millisecondsSince(writeStart);
+    }
+
+    char reply[256];
+    snprintf(reply, sizeof(reply), "ok cameras=%d cached=%d load_ms=%.3f render_ms=%.3f write_ms=%.3f total_ms=%.3f redrawn_pixels=%lld",
+             (int)cameras.size(), cached ? 1 : 0, loadTime, renderTime, writeTime, millisecondsSince(start), redrawnPixels);
+    return reply;
+}
+
+/*
+    Returns the resident scene of the file, loading it when it is not loaded yet or
+    changed since. Returns NULL with a message in error when it can not be loaded.
+*/
+ResidentScene *RenderServer::getScene(const string &path, bool &cached, string &error)
+{
+    FileStatus file;
+    if (!file.read(path))
+    {
+        error = "can not read " + path;
+        return NULL;
+    }
+
+    ResidentScene &resident = this->scenes[path];
+    cached = resident.scene != NULL && resident.file.modificationTime == file.modificationTime && resident.file.size == file.size;
+    for (int i = 0; cached && i < resident.scene->importedFiles.size(); i++)
+    {
+        cached = resident.scene->importedFiles[i].isUnchanged();
+    }
+
+    if (!cached)
+    {
+        resident.release();
+        resident.scene = new Scene(path.c_str());
+        resident.file = file;
+
+        if (resident.scene->cameras.empty())
+        {
+            resident.release();
+            this->scenes.erase(path);
+            error = "no cameras in " + path;
+            return NULL;
+        }
+        resident.renderer = new TiledRenderer(resident.scene, this->pool);
+    }
+    resident.lastUse = ++this->useCount;
+
+    evictScenes();
+    return &resident;
+}
+
+void RenderServer::evictScenes()
+{
+    while (this->scenes.size() > RENDER_SERVER_MAX_SCENES)
+    {
+        map<string, ResidentScene>::iterator oldest = this->scenes.begin();
+        for (map<string, ResidentScene>::iterator it = this->scenes.begin(); it != this->scenes.end(); ++it)
+        {
+            if (it->second.lastUse < oldest->second.lastUse)
+                oldest = it;
+        }
+        oldest->second.release();
+        this->scenes.erase(oldest);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef __RENDER_SERVER_H__
+#define __RENDER_SERVER_H__
+#define RENDER_SERVER_MAX_SCENES 16
+#define RENDER_SERVER_MAX_REQUEST 65536
+#include <map>
+#include <string>
+#include <vector>
+#include "FileStatus.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "TiledRenderer.h"
+#include "IncrementalRenderer.h"
+
+/*
+    A parsed scene kept between requests, valid while its file and the mesh files it
+    imports keep the same modification time and size.
+*/
+class ResidentScene
+{
+public:
+    Scene *scene;
+    TiledRenderer *renderer;
+    FileStatus file; // of the scene file when it was loaded
+    long long lastUse;
+    std::map<int, IncrementalRenderer *> incrementalRenderers; // by camera id
+
+    ResidentScene();
+
+    void release();
+};
+
+/*
+    Keeps parsed scenes in memory and renders them on request, so that repeated renders
+    of the same scene pay neither process startup nor parsing. Clients connect to a Unix
+    domain socket and send requests of one "key value" line per field, ended by an empty
+    line:
+        scene PATH          scene file, required
+        cameras ID ID ...   ids of the cameras to render, all cameras when missing
+        output PATH         output file, "%d" is replaced by the camera id and is required
+                            for more than one camera. The camera's output file when missing
+        format p3|p6|png|qoi  as --format, by the output file extension when missing
+        translation ID TX TY TZ, scaling ID SX SY SZ, rotation ID ANGLE UX UY UZ
+                            change a transformation of the loaded scene before rendering,
+                            the change stays until the scene file changes. Nothing is
+                            changed when any field of the request is rejected
+        incremental         keep the last image of each camera with its depths and primitive
+                            ids, and redraw only what changed transformations touch, see
+                            IncrementalRenderer
+    Each request gets one reply line, "ok" followed by timing stats:
+        ok cameras=N cached=0|1 load_ms=T render_ms=T write_ms=T total_ms=T redrawn_pixels=N
+    or "error" followed by a message. Requests are served one at a time in the order
+    they arrive, each one rendered on the whole pool. A scene is loaded again when its
+    file or a mesh file it imports changed, at most RENDER_SERVER_MAX_SCENES scenes
+    stay loaded, the least recently used ones are dropped first.
+*/
+class RenderServer
+{
+public:
+    ThreadPool *pool;
+
+    RenderServer(ThreadPool *pool);
+    ~RenderServer();
+
+    // creates the socket, replacing a stale socket file left at path
+    bool listen(const char *socketPath);
+
+    // serves clients until the process gets SIGINT or SIGTERM, then removes the socket file
+    void run();
+
+private:
+    int listener;
+    std::string socketPath;
+    std::map<std::string, ResidentScene> scenes;
+    long long useCount;
+    FrameBuffer frameBuffer;
+
+    std::string handleRequest(const std::string &request);
+    ResidentScene *getScene(const std::string &path, bool &cached, std::string &error);
+    void evictScenes();
+};
+
+#endif
@@ -11,16 +11,377 @@
 #include "Triangle.h"
 #include "Helpers.h"
 #include "Scene.h"
+#include "PngEncoder.h"
+#include "QoiEncoder.h"
+#include "TextParser.h"
+#include "MappedFile.h"
+#include "XmlReader.h"
+#include "SceneCache.h"
+#include "MeshImporter.h"
 
 using namespace tinyxml2;
 using namespace std;
-#define MAX_DEPTH 99.99
 
 
 /*
-	Parses XML file
+	Creates an empty scene, to be filled by the caller.
+*/
+Scene::Scene()
+{
+	this->outputFormat = OUTPUT_BY_EXTENSION;
+	this->videoWriter = NULL;
+	this->cullingEnabled = false;
+}
+
+/*
+	Parses XML file. The streaming loader reads it first, files using XML features it
+	does not handle are loaded again through a tinyxml2 document. Scene cache files
+	are recognized by their header and loaded from the cache instead.
 */
 Scene::Scene(const char *xmlPath)
+{
+	this->outputFormat = OUTPUT_BY_EXTENSION;
+	this->videoWriter = NULL;
+	this->cullingEnabled = false;
+
+	if (isSceneCacheFile(xmlPath))
+	{
+		if (!readSceneCache(this, xmlPath))
+		{
+			cerr << "Invalid scene cache file: " << xmlPath << endl;
+			clear();
+		}
+	}
+	else
+	{
+		// read before parsing, so that an edit made while parsing leaves the scene out of date
+		FileStatus file;
+		file.read(xmlPath);
+
+		if (!loadXMLStream(xmlPath))
+		{
+			clear();
+			loadXMLDocument(xmlPath);
+		}
+		importMeshFiles(xmlPath);
+		updateModelingTransformations();
+		this->sourceFile = file;
+	}
+
+	for (int i = 0; i < this->meshes.size(); i++)
+	{
+		this->meshes[i]->computeVertexRange();
+	}
+}
+
+/*
+	Frees everything the scene owns. Scene objects all live in the arena, so they
+	are released at once instead of one by one.
+*/
+void Scene::clear()
+{
+	this->arena.release();
+
+	this->cameras.clear();
+	this->vertices.clear();
+	this->colorsOfVertices.clear();
+	this->scalings.clear();
+	this->rotations.clear();
+	this->translations.clear();
+	this->meshes.clear();
+	this->sourceFile = FileStatus();
+	this->importedFiles.clear();
+	this->cullingEnabled = false;
+}
+
+/*
+	Adds the faces of the meshes that name an OBJ or PLY file in their file attribute.
+	Paths are relative to the scene file, the vertices of each file are added after the
+	ones already in the scene. The status of each file is kept in importedFiles.
+*/
+void Scene::importMeshFiles(const char *xmlPath)
+{
+	string directory = xmlPath;
+	size_t slash = directory.find_last_of("/\\");
+	directory = slash == string::npos ? "" : directory.substr(0, slash + 1);
+
+	for (int i = 0; i < this->meshes.size(); i++)
+	{
+		Mesh *mesh = this->meshes[i];
+		if (mesh->fileName.empty())
+			continue;
+
+		string &name = mesh->fileName;
+		bool absolute = name[0] == '/' || name[0] == '\\' || (name.size() > 1 && name[1] == ':');
+		string path = absolute ? name : directory + name;
+		string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+		for (int k = 0; k < extension.size(); k++)
+			extension[k] = tolower(extension[k]);
+
+		FileStatus file;
+		file.read(path);
+		this->importedFiles.push_back(file);
+
+		bool imported = false;
+		if (extension == ".obj")
+			imported = importOBJ(path.c_str(), this, mesh);
+		else if (extension == ".ply")
+			imported = importPLY(path.c_str(), this, mesh);
+		if (!imported)
+			cerr << "Could not import the mesh file " << path << endl;
+
+		mesh->numberOfTriangles = mesh->triangles.size();
+		if (mesh->type == WIREFRAME_MESH)
+		{
+			mesh->buildEdgeList();
+		}
+	}
+}
+
+Scene::~Scene()
+{
+	clear();
+}
+
+/*
+	Fills in the counts and the edge list of a mesh whose element has been read.
+*/
+static void finishMesh(Mesh *mesh)
+{
+	mesh->numberOfTransformations = mesh->transformationIds.size();
+	mesh->numberOfTriangles = mesh->triangles.size();
+	if (mesh->type == WIREFRAME_MESH)
+	{
+		mesh->buildEdgeList();
+	}
+}
+
+/*
+	Reads the scene while walking the memory-mapped file once, without building a
+	document: every element is turned into scene data as soon as it is read.
+	Returns false when the file can not be read this way.
+*/
+bool Scene::loadXMLStream(const char *xmlPath)
+{
+	MappedFile file;
+	if (!file.open(xmlPath) || file.size == 0)
+		return false;
+
+	XmlReader reader(file.data, file.data + file.size);
+	const char *value, *valueEnd;
+	Camera *camera = NULL;
+	Mesh *mesh = NULL;
+	int vertexId = 1;
+	int token;
+	bool failed = false;
+
+	while (!failed && (token = reader.next()) != XML_END)
+	{
+		if (token == XML_UNSUPPORTED)
+		{
+			failed = true;
+			continue;
+		}
+
+		if (token == XML_END_TAG)
+		{
+			if (reader.isName("Camera") && camera != NULL)
+			{
+				camera->setupBasis();
+				this->cameras.push_back(camera);
+				camera = NULL;
+			}
+			else if (reader.isName("Mesh") && mesh != NULL)
+			{
+				finishMesh(mesh);
+				this->meshes.push_back(mesh);
+				mesh = NULL;
+			}
+			continue;
+		}
+		if (token != XML_START_TAG)
+			continue;
+
+		if (reader.isName("BackgroundColor"))
+		{
+			if (!reader.readText(value, valueEnd))
+			{
+				failed = true;
+				continue;
+			}
+			value = parseDouble(value, backgroundColor.r);
+			value = parseDouble(value, backgroundColor.g);
+			parseDouble(value, backgroundColor.b);
+		}
+		else if (reader.isName("Culling"))
+		{
+			if (!reader.readText(value, valueEnd))
+			{
+				failed = true;
+				continue;
+			}
+			this->cullingEnabled = valueEnd - value == 7 && memcmp(value, "enabled", 7) == 0;
+		}
+		else if (reader.isName("Camera"))
+		{
+			camera = this->arena.create<Camera>();
+			if (reader.getAttribute("id", value, valueEnd))
+				parseInt(value, camera->cameraId);
+			bool orthographic = reader.getAttribute("type", value, valueEnd) && valueEnd - value == 12 && memcmp(value, "orthographic", 12) == 0;
+			camera->projectionType = orthographic ? ORTOGRAPHIC_PROJECTION : PERSPECTIVE_PROJECTION;
+		}
+		else if (camera != NULL && (reader.isName("Position") || reader.isName("Gaze") || reader.isName("Up")))
+		{
+			Vec3 &vector = reader.isName("Position") ? camera->position : reader.isName("Gaze") ? camera->gaze : camera->v;
+			if (!reader.readText(value, valueEnd))
+			{
+				failed = true;
+				continue;
+			}
+			value = parseDouble(value, vector.x);
+			value = parseDouble(value, vector.y);
+			parseDouble(value, vector.z);
+		}
+		else if (camera != NULL && reader.isName("ImagePlane"))
+		{
+			if (!reader.readText(value, valueEnd))
+			{
+				failed = true;
+				continue;
+			}
+			value = parseDouble(value, camera->left);
+			value = parseDouble(value, camera->right);
+			value = parseDouble(value, camera->bottom);
+			value = parseDouble(value, camera->top);
+			value = parseDouble(value, camera->near);
+			value = parseDouble(value, camera->far);
+			value = parseInt(value, camera->horRes);
+			parseInt(value, camera->verRes);
+		}
+		else if (camera != NULL && reader.isName("OutputName"))
+		{
+			if (!reader.readText(value, valueEnd))
+			{
+				failed = true;
+				continue;
+			}
+			camera->outputFilename = string(value, valueEnd);
+		}
+		else if (reader.isName("Vertex"))
+		{
+			Vec3 *vertex = this->arena.create<Vec3>();
+			Color *color = this->arena.create<Color>();
+
+			vertex->colorId = vertexId++;
+			this->vertices.push_back(vertex);
+			this->colorsOfVertices.push_back(color);
+
+			if (reader.getAttribute("position", value, valueEnd))
+			{
+				value = parseDouble(value, vertex->x);
+				value = parseDouble(value, vertex->y);
+				parseDouble(value, vertex->z);
+			}
+			if (reader.getAttribute("color", value, valueEnd))
+			{
+				value = parseDouble(value, color->r);
+				value = parseDouble(value, color->g);
+				parseDouble(value, color->b);
+			}
+		}
+		else if (reader.isName("Translation"))
+		{
+			Translation *translation = this->arena.create<Translation>();
+			this->translations.push_back(translation);
+
+			if (reader.getAttribute("id", value, valueEnd))
+				parseInt(value, translation->translationId);
+			if (reader.getAttribute("value", value, valueEnd))
+			{
+				value = parseDouble(value, translation->tx);
+				value = parseDouble(value, translation->ty);
+				parseDouble(value, translation->tz);
+			}
+		}
+		else if (reader.isName("Scaling"))
+		{
+			Scaling *scaling = this->arena.create<Scaling>();
+			this->scalings.push_back(scaling);
+
+			if (reader.getAttribute("id", value, valueEnd))
+				parseInt(value, scaling->scalingId);
+			if (reader.getAttribute("value", value, valueEnd))
+			{
+				value = parseDouble(value, scaling->sx);
+				value = parseDouble(value, scaling->sy);
+				parseDouble(value, scaling->sz);
+			}
+		}
+		else if (reader.isName("Rotation"))
+		{
+			Rotation *rotation = this->arena.create<Rotation>();
+			this->rotations.push_back(rotation);
+
+			if (reader.getAttribute("id", value, valueEnd))
+				parseInt(value, rotation->rotationId);
+			if (reader.getAttribute("value", value, valueEnd))
+			{
+				value = parseDouble(value, rotation->angle);
+				value = parseDouble(value, rotation->ux);
+				value = parseDouble(value, rotation->uy);
+				parseDouble(value, rotation->uz);
+			}
+		}
+		else if (reader.isName("Mesh"))
+		{
+			mesh = this->arena.create<Mesh>();
+			if (reader.getAttribute("id", value, valueEnd))
+				parseInt(value, mesh->meshId);
+			bool wireframe = reader.getAttribute("type", value, valueEnd) && valueEnd - value == 9 && memcmp(value, "wireframe", 9) == 0;
+			mesh->type = wireframe ? WIREFRAME_MESH : SOLID_MESH;
+			if (reader.getAttribute("file", value, valueEnd))
+				mesh->fileName = string(value, valueEnd);
+
+			// a mesh read from a file may be a single <Mesh ... /> element
+			if (reader.selfClosing)
+			{
+				finishMesh(mesh);
+				this->meshes.push_back(mesh);
+				mesh = NULL;
+			}
+		}
+		else if (mesh != NULL && reader.isName("Transformation"))
+		{
+			if (!reader.readText(value, valueEnd) || value == valueEnd)
+			{
+				failed = true;
+				continue;
+			}
+			int transformationId = 0;
+			parseInt(value + 1, transformationId);
+			mesh->transformationTypes.push_back(*value);
+			mesh->transformationIds.push_back(transformationId);
+		}
+		else if (mesh != NULL && reader.isName("Faces"))
+		{
+			if (!reader.readText(value, valueEnd))
+			{
+				failed = true;
+				continue;
+			}
+			parseFaces(value, valueEnd, mesh->triangles);
+		}
+	}
+
+	// an element left open means the file is cut short, it is freed with the arena
+	failed = failed || camera != NULL || mesh != NULL;
+	return !failed;
+}
+
+/*
+	Reads the scene from a tinyxml2 document.
+*/
+void Scene::loadXMLDocument(const char *xmlPath)
 {
 	const char *str;
 	XMLDocument xmlDoc;
@@ -28,12 +389,19 @@ Scene::Scene(const char *xmlPath)
 
 	xmlDoc.LoadFile(xmlPath);
 
-	XMLNode *rootNode = xmlDoc.FirstChild();
+	XMLNode *rootNode = xmlDoc.FirstChildElement();
+	if (rootNode == NULL)
+	{
+		cerr << "Could not read the scene " << xmlPath << endl;
+		return;
+	}
 
 	// read background color
 	xmlElement = rootNode->FirstChildElement("BackgroundColor");
 	str = xmlElement->GetText();
-	sscanf(str, "%lf %lf %lf", &backgroundColor.r, &backgroundColor.g, &backgroundColor.b);
+	str = parseDouble(str, backgroundColor.r);
+	str = parseDouble(str, backgroundColor.g);
+	parseDouble(str, backgroundColor.b);
 
 	// read culling
 	xmlElement = rootNode->FirstChildElement("Culling");
@@ -57,7 +425,7 @@ Scene::Scene(const char *xmlPath)
 	XMLElement *camFieldElement;
 	while (camElement != NULL)
 	{
-		Camera *camera = new Camera();
+		Camera *camera = this->arena.create<Camera>();
 
 		camElement->QueryIntAttribute("id", &camera->cameraId);
 
@@ -75,29 +443,34 @@ Scene::Scene(const char *xmlPath)
 
 		camFieldElement = camElement->FirstChildElement("Position");
 		str = camFieldElement->GetText();
-		sscanf(str, "%lf %lf %lf", &camera->position.x, &camera->position.y, &camera->position.z);
+		str = parseDouble(str, camera->position.x);
+		str = parseDouble(str, camera->position.y);
+		parseDouble(str, camera->position.z);
 
 		camFieldElement = camElement->FirstChildElement("Gaze");
 		str = camFieldElement->GetText();
-		sscanf(str, "%lf %lf %lf", &camera->gaze.x, &camera->gaze.y, &camera->gaze.z);
+		str = parseDouble(str, camera->gaze.x);
+		str = parseDouble(str, camera->gaze.y);
+		parseDouble(str, camera->gaze.z);
 
 		camFieldElement = camElement->FirstChildElement("Up");
 		str = camFieldElement->GetText();
-		sscanf(str, "%lf %lf %lf", &camera->v.x, &camera->v.y, &camera->v.z);
-
-		camera->gaze = normalizeVec3(camera->gaze);
-		camera->u = crossProductVec3(camera->gaze, camera->v);
-		camera->u = normalizeVec3(camera->u);
+		str = parseDouble(str, camera->v.x);
+		str = parseDouble(str, camera->v.y);
+		parseDouble(str, camera->v.z);
 
-		camera->w = inverseVec3(camera->gaze);
-		camera->v = crossProductVec3(camera->u, camera->gaze);
-		camera->v = normalizeVec3(camera->v);
+		camera->setupBasis();
 
 		camFieldElement = camElement->FirstChildElement("ImagePlane");
 		str = camFieldElement->GetText();
-		sscanf(str, "%lf %lf %lf %lf %lf %lf %d %d",
-			   &camera->left, &camera->right, &camera->bottom, &camera->top,
-			   &camera->near, &camera->far, &camera->horRes, &camera->verRes);
+		str = parseDouble(str, camera->left);
+		str = parseDouble(str, camera->right);
+		str = parseDouble(str, camera->bottom);
+		str = parseDouble(str, camera->top);
+		str = parseDouble(str, camera->near);
+		str = parseDouble(str, camera->far);
+		str = parseInt(str, camera->horRes);
+		parseInt(str, camera->verRes);
 
 		camFieldElement = camElement->FirstChildElement("OutputName");
 		str = camFieldElement->GetText();
@@ -115,16 +488,20 @@ Scene::Scene(const char *xmlPath)
 
 	while (vertexElement != NULL)
 	{
-		Vec3 *vertex = new Vec3();
-		Color *color = new Color();
+		Vec3 *vertex = this->arena.create<Vec3>();
+		Color *color = this->arena.create<Color>();
 
 		vertex->colorId = vertexId;
 
 		str = vertexElement->Attribute("position");
-		sscanf(str, "%lf %lf %lf", &vertex->x, &vertex->y, &vertex->z);
+		str = parseDouble(str, vertex->x);
+		str = parseDouble(str, vertex->y);
+		parseDouble(str, vertex->z);
 
 		str = vertexElement->Attribute("color");
-		sscanf(str, "%lf %lf %lf", &color->r, &color->g, &color->b);
+		str = parseDouble(str, color->r);
+		str = parseDouble(str, color->g);
+		parseDouble(str, color->b);
 
 		this->vertices.push_back(vertex);
 		this->colorsOfVertices.push_back(color);
@@ -139,12 +516,14 @@ Scene::Scene(const char *xmlPath)
 	XMLElement *translationElement = xmlElement->FirstChildElement("Translation");
 	while (translationElement != NULL)
 	{
-		Translation *translation = new Translation();
+		Translation *translation = this->arena.create<Translation>();
 
 		translationElement->QueryIntAttribute("id", &translation->translationId);
 
 		str = translationElement->Attribute("value");
-		sscanf(str, "%lf %lf %lf", &translation->tx, &translation->ty, &translation->tz);
+		str = parseDouble(str, translation->tx);
+		str = parseDouble(str, translation->ty);
+		parseDouble(str, translation->tz);
 
 		this->translations.push_back(translation);
 
@@ -156,11 +535,13 @@ Scene::Scene(const char *xmlPath)
 	XMLElement *scalingElement = xmlElement->FirstChildElement("Scaling");
 	while (scalingElement != NULL)
 	{
-		Scaling *scaling = new Scaling();
+		Scaling *scaling = this->arena.create<Scaling>();
 
 		scalingElement->QueryIntAttribute("id", &scaling->scalingId);
 		str = scalingElement->Attribute("value");
-		sscanf(str, "%lf %lf %lf", &scaling->sx, &scaling->sy, &scaling->sz);
+		str = parseDouble(str, scaling->sx);
+		str = parseDouble(str, scaling->sy);
+		parseDouble(str, scaling->sz);
 
 		this->scalings.push_back(scaling);
 
@@ -172,11 +553,14 @@ Scene::Scene(const char *xmlPath)
 	XMLElement *rotationElement = xmlElement->FirstChildElement("Rotation");
 	while (rotationElement != NULL)
 	{
-		Rotation *rotation = new Rotation();
+		Rotation *rotation = this->arena.create<Rotation>();
 
 		rotationElement->QueryIntAttribute("id", &rotation->rotationId);
 		str = rotationElement->Attribute("value");
-		sscanf(str, "%lf %lf %lf %lf", &rotation->angle, &rotation->ux, &rotation->uy, &rotation->uz);
+		str = parseDouble(str, rotation->angle);
+		str = parseDouble(str, rotation->ux);
+		str = parseDouble(str, rotation->uy);
+		parseDouble(str, rotation->uz);
 
 		this->rotations.push_back(rotation);
 
@@ -189,7 +573,7 @@ Scene::Scene(const char *xmlPath)
 	XMLElement *meshElement = xmlElement->FirstChildElement("Mesh");
 	while (meshElement != NULL)
 	{
-		Mesh *mesh = new Mesh();
+		Mesh *mesh = this->arena.create<Mesh>();
 
 		meshElement->QueryIntAttribute("id", &mesh->meshId);
 
@@ -207,7 +591,7 @@ Scene::Scene(const char *xmlPath)
 
 		// read mesh transformations
 		XMLElement *meshTransformationsElement = meshElement->FirstChildElement("Transformations");
-		XMLElement *meshTransformationElement = meshTransformationsElement->FirstChildElement("Transformation");
+		XMLElement *meshTransformationElement = meshTransformationsElement != NULL ? meshTransformationsElement->FirstChildElement("Transformation") : NULL;
 
 		while (meshTransformationElement != NULL)
 		{
@@ -215,7 +599,8 @@ Scene::Scene(const char *xmlPath)
 			int transformationId;
 
 			str = meshTransformationElement->GetText();
-			sscanf(str, "%c %d", &transformationType, &transformationId);
+			transformationType = *str;
+			parseInt(str + 1, transformationId);
 
 			mesh->transformationTypes.push_back(transformationType);
 			mesh->transformationIds.push_back(transformationId);
@@ -225,26 +610,26 @@ Scene::Scene(const char *xmlPath)
 
 		mesh->numberOfTransformations = mesh->transformationIds.size();
 
-		// read mesh faces
-		char *row;
-		char *cloneStr;
-		int v1, v2, v3;
+		// read mesh faces, parsed in place. Meshes read from a file may have none
 		XMLElement *meshFacesElement = meshElement->FirstChildElement("Faces");
-		str = meshFacesElement->GetText();
-		cloneStr = strdup(str);
+		str = meshFacesElement != NULL ? meshFacesElement->GetText() : NULL;
+		if (str != NULL)
+		{
+			parseFaces(str, str + strlen(str), mesh->triangles);
+		}
+		mesh->numberOfTriangles = mesh->triangles.size();
 
-		row = strtok(cloneStr, "\n");
-		while (row != NULL)
+		str = meshElement->Attribute("file");
+		if (str != NULL)
 		{
-			int result = sscanf(row, "%d %d %d", &v1, &v2, &v3);
+			mesh->fileName = str;
+		}
 
-			if (result != EOF)
-			{
-				mesh->triangles.push_back(Triangle(v1, v2, v3));
-			}
-			row = strtok(NULL, "\n");
+		if (mesh->type == WIREFRAME_MESH)
+		{
+			mesh->buildEdgeList();
 		}
-		mesh->numberOfTriangles = mesh->triangles.size();
+
 		this->meshes.push_back(mesh);
 
 		meshElement = meshElement->NextSiblingElement("Mesh");
@@ -256,32 +641,13 @@ Scene::Scene(const char *xmlPath)
 */
 void Scene::initializeImage(Camera *camera)
 {
-	if (this->image.empty())
-	{
-		for (int i = 0; i < camera->horRes; i++)
-		{
-			vector<Color> rowOfColors;
-
-			for (int j = 0; j < camera->verRes; j++)
-			{
-				rowOfColors.push_back(this->backgroundColor);
-			}
+	initializeImage(camera, this->frameBuffer);
+}
 
-			this->image.push_back(rowOfColors);
-		}
-	}
-	else
-	{
-		for (int i = 0; i < camera->horRes; i++)
-		{
-			for (int j = 0; j < camera->verRes; j++)
-			{
-				this->image[i][j].r = this->backgroundColor.r;
-				this->image[i][j].g = this->backgroundColor.g;
-				this->image[i][j].b = this->backgroundColor.b;
-			}
-		}
-	}
+void Scene::initializeImage(Camera *camera, FrameBuffer &frameBuffer)
+{
+	frameBuffer.resize(camera->horRes, camera->verRes);
+	frameBuffer.clearColor(this->backgroundColor);
 }
 
 /*
@@ -303,6 +669,11 @@ int Scene::makeBetweenZeroAnd255(double value)
 	Writes contents of image (Color**) into a PPM file.
 */
 void Scene::writeImageToPPMFile(Camera *camera)
+{
+	writeImageToPPMFile(camera, this->frameBuffer);
+}
+
+void Scene::writeImageToPPMFile(Camera *camera, FrameBuffer &frameBuffer)
 {
 	ofstream fout;
 
@@ -317,20 +688,192 @@ void Scene::writeImageToPPMFile(Camera *camera)
 	{
 		for (int i = 0; i < camera->horRes; i++)
 		{
-			fout << makeBetweenZeroAnd255(this->image[i][j].r) << " "
-				 << makeBetweenZeroAnd255(this->image[i][j].g) << " "
-				 << makeBetweenZeroAnd255(this->image[i][j].b) << " ";
+			Color &color = frameBuffer.colors[j * camera->horRes + i];
+			fout << makeBetweenZeroAnd255(color.r) << " "
+				 << makeBetweenZeroAnd255(color.g) << " "
+				 << makeBetweenZeroAnd255(color.b) << " ";
 		}
 		fout << endl;
 	}
 	fout.close();
 }
 
+/*
+	Same output as above, but the rows are formatted in strips on the thread pool and
+	the strips are written in order.
+*/
+void Scene::writeImageToPPMFile(Camera *camera, FrameBuffer &frameBuffer, ThreadPool *pool)
+{
+	int stripCount = (camera->verRes + PPM_STRIP_ROWS - 1) / PPM_STRIP_ROWS;
+	vector<string> strips(stripCount);
+
+	pool->parallelFor(stripCount, [&](int strip)
+	{
+		// strip 0 holds the top rows, which come first in the file
+		int top = camera->verRes - 1 - strip * PPM_STRIP_ROWS;
+		int bottom = max(0, top - PPM_STRIP_ROWS + 1);
+		string &text = strips[strip];
+		char number[16];
+
+		text.reserve((top - bottom + 1) * (camera->horRes * 12 + 1));
+		for (int j = top; j >= bottom; j--)
+		{
+			for (int i = 0; i < camera->horRes; i++)
+			{
+				Color &color = frameBuffer.colors[j * camera->horRes + i];
+				text.append(number, sprintf(number, "%d %d %d ", makeBetweenZeroAnd255(color.r),
+											makeBetweenZeroAnd255(color.g), makeBetweenZeroAnd255(color.b)));
+			}
+			text += '\n';
+		}
+	});
+
+	ofstream fout;
+
+	fout.open(camera->outputFilename.c_str());
+
+	fout << "P3" << endl;
+	fout << "# " << camera->outputFilename << endl;
+	fout << camera->horRes << " " << camera->verRes << endl;
+	fout << "255" << endl;
+
+	for (int i = 0; i < stripCount; i++)
+	{
+		fout << strips[i];
+	}
+	fout.close();
+}
+
+/*
+	Writes the image as binary PPM (P6). The whole file is built in one buffer
+	and written with a single call.
+*/
+void Scene::writeImageToBinaryPPMFile(Camera *camera, FrameBuffer &frameBuffer)
+{
+	char header[64];
+	int headerLength = sprintf(header, "P6\n%d %d\n255\n", frameBuffer.width, frameBuffer.height);
+	vector<unsigned char> data(headerLength + frameBuffer.width * frameBuffer.height * 3);
+
+	memcpy(&data[0], header, headerLength);
+	frameBuffer.quantize(&data[headerLength]);
+
+	ofstream fout(camera->outputFilename.c_str(), ios::binary);
+	fout.write((const char *)&data[0], data.size());
+	fout.close();
+}
+
+/*
+	Returns the output file name of the camera with its extension replaced by the given one.
+*/
+string Scene::getOutputPath(Camera *camera, const char *extension)
+{
+	string path = camera->outputFilename;
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+
+	if (dot != string::npos && (slash == string::npos || dot > slash))
+		path.erase(dot);
+	return path + extension;
+}
+
+/*
+	Encodes the image as PNG straight from the frame buffer, PPM_STRIP_ROWS rows at a time.
+*/
+void Scene::writeImageToPNGFile(Camera *camera, FrameBuffer &frameBuffer)
+{
+	ofstream fout(getOutputPath(camera, ".png").c_str(), ios::binary);
+	PngEncoder encoder;
+	vector<unsigned char> pixels(PPM_STRIP_ROWS * frameBuffer.width * 3);
+
+	encoder.begin(fout, frameBuffer.width, frameBuffer.height);
+	for (int top = frameBuffer.height - 1; top >= 0; top -= PPM_STRIP_ROWS)
+	{
+		int bottom = max(0, top - PPM_STRIP_ROWS + 1);
+
+		frameBuffer.quantizeRows(top, bottom, &pixels[0]);
+		encoder.writeRows(&pixels[0], top - bottom + 1);
+	}
+	encoder.finish();
+	fout.close();
+}
+
+/*
+	Encodes the image as QOI straight from the frame buffer, PPM_STRIP_ROWS rows at a time.
+*/
+void Scene::writeImageToQOIFile(Camera *camera, FrameBuffer &frameBuffer)
+{
+	ofstream fout(getOutputPath(camera, ".qoi").c_str(), ios::binary);
+	QoiEncoder encoder;
+	vector<unsigned char> pixels(PPM_STRIP_ROWS * frameBuffer.width * 3);
+
+	encoder.begin(fout, frameBuffer.width, frameBuffer.height);
+	for (int top = frameBuffer.height - 1; top >= 0; top -= PPM_STRIP_ROWS)
+	{
+		int bottom = max(0, top - PPM_STRIP_ROWS + 1);
+
+		frameBuffer.quantizeRows(top, bottom, &pixels[0]);
+		encoder.writeRows(&pixels[0], top - bottom + 1);
+	}
+	encoder.finish();
+	fout.close();
+}
+
+/*
+	Returns the selected output format, or with OUTPUT_BY_EXTENSION the one the output
+	file name of the camera ends with. Names without .png or .qoi get ASCII PPM files.
+*/
+int Scene::getOutputFormat(Camera *camera)
+{
+	if (this->outputFormat != OUTPUT_BY_EXTENSION)
+		return this->outputFormat;
+
+	string &name = camera->outputFilename;
+	if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".png") == 0)
+		return OUTPUT_PNG;
+	if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".qoi") == 0)
+		return OUTPUT_QOI;
+	return OUTPUT_PPM_ASCII;
+}
+
+/*
+	Writes the image in the selected output format, or as the next frame of the video stream.
+*/
+void Scene::writeImage(Camera *camera, FrameBuffer &frameBuffer)
+{
+	writeImage(camera, frameBuffer, NULL);
+}
+
+/*
+	The same, formatting ASCII PPM files on the pool when one is given.
+*/
+void Scene::writeImage(Camera *camera, FrameBuffer &frameBuffer, ThreadPool *pool)
+{
+	if (this->videoWriter != NULL)
+	{
+		this->videoWriter->writeFrame(camera, frameBuffer);
+		return;
+	}
+
+	int format = getOutputFormat(camera);
+
+	if (format == OUTPUT_QOI)
+		writeImageToQOIFile(camera, frameBuffer);
+	else if (format == OUTPUT_PNG)
+		writeImageToPNGFile(camera, frameBuffer);
+	else if (format == OUTPUT_PPM_BINARY)
+		writeImageToBinaryPPMFile(camera, frameBuffer);
+	else if (pool != NULL)
+		writeImageToPPMFile(camera, frameBuffer, pool);
+	else
+		writeImageToPPMFile(camera, frameBuffer);
+}
+
 /*
 	Converts PPM image in given path to PNG file, by calling ImageMagick's 'convert' command.
 	os_type == 1 		-> Ubuntu
 	os_type == 2 		-> Windows
 	os_type == other	-> No conversion
+	The rasterizer itself writes PNG files without ImageMagick when run with --format png.
 */
 void Scene::convertPPMToPNG(string ppmFileName, int osType)
 {
@@ -378,49 +921,132 @@ Matrix4 Scene::getModelingTransformationMatrix(Mesh* mesh) {
 	return modelingTransformationMatrix;
 }
 
-std::vector<Vec4> Scene::getTransformedTriangleVertices(Triangle& triangle, Matrix4& transformationMatrix, std::vector<Vec3 *>& vertices) {
-	std::vector<Vec4> transformed_vertices;
+/*
+	Composes the modeling transformation of every mesh again, after translations,
+	scalings or rotations changed.
+*/
+void Scene::updateModelingTransformations() {
+	for(int i = 0; i < this->meshes.size(); i++) {
+		this->meshes[i]->modelingTransformation = getModelingTransformationMatrix(this->meshes[i]);
+	}
+}
 
-	Vec3 vertex_0 = *vertices[triangle.vertexIds[0] - 1];
-	Vec3 vertex_1 = *vertices[triangle.vertexIds[1] - 1];
-	Vec3 vertex_2 = *vertices[triangle.vertexIds[2] - 1];
+/*
+	Sets the values of translation ('t'), scaling ('s') or rotation ('r') transformationId,
+	in the order of the scene file. The meshes see them after updateModelingTransformations.
+*/
+void Scene::setTransformation(char type, int transformationId, double* values) {
+	if(type == 't') {
+		Translation* translation = this->translations[transformationId-1];
+		translation->tx = values[0];
+		translation->ty = values[1];
+		translation->tz = values[2];
+	}
+	else if(type == 's') {
+		Scaling* scaling = this->scalings[transformationId-1];
+		scaling->sx = values[0];
+		scaling->sy = values[1];
+		scaling->sz = values[2];
+	}
+	else if(type == 'r') {
+		Rotation* rotation = this->rotations[transformationId-1];
+		rotation->angle = values[0];
+		rotation->ux = values[1];
+		rotation->uy = values[2];
+		rotation->uz = values[3];
+	}
+}
 
-	Vec4 transformed_vertex_0 = multiplyMatrixWithVec4(transformationMatrix, Vec4(vertex_0.x, vertex_0.y, vertex_0.z, 1));
-	Vec4 transformed_vertex_1 = multiplyMatrixWithVec4(transformationMatrix, Vec4(vertex_1.x, vertex_1.y, vertex_1.z, 1));
-	Vec4 transformed_vertex_2 = multiplyMatrixWithVec4(transformationMatrix, Vec4(vertex_2.x, vertex_2.y, vertex_2.z, 1));
+Vec4 Scene::getTransformedVertex(int vertexId, Matrix4& transformationMatrix) {
+	Vec3 vertex = *this->vertices[vertexId - 1];
 
+	Vec4 transformed_vertex = multiplyMatrixWithVec4(transformationMatrix, Vec4(vertex.x, vertex.y, vertex.z, 1));
 
-	transformed_vertex_0.x /= transformed_vertex_0.t;
-	transformed_vertex_0.y /= transformed_vertex_0.t;
-	transformed_vertex_0.z /= transformed_vertex_0.t;
-	transformed_vertex_0.t = 1;
+	transformed_vertex.x /= transformed_vertex.t;
+	transformed_vertex.y /= transformed_vertex.t;
+	transformed_vertex.z /= transformed_vertex.t;
+	transformed_vertex.t = 1;
 
-	transformed_vertex_1.x /= transformed_vertex_1.t;
-	transformed_vertex_1.y /= transformed_vertex_1.t;
-	transformed_vertex_1.z /= transformed_vertex_1.t;
-	transformed_vertex_1.t = 1;
+	return transformed_vertex;
+}
 
-	transformed_vertex_2.x /= transformed_vertex_2.t;
-	transformed_vertex_2.y /= transformed_vertex_2.t;
-	transformed_vertex_2.z /= transformed_vertex_2.t;
-	transformed_vertex_2.t = 1;
+/*
+	Transforms the vertices firstVertexId + begin .. firstVertexId + end - 1 of the mesh
+	into transformedVertices[begin] .. transformedVertices[end - 1], so that a vertex shared
+	by several triangles is transformed once per camera.
+*/
+void Scene::transformVertices(Mesh* mesh, Matrix4& transformationMatrix, int begin, int end, std::vector<Vec4>& transformedVertices) {
+	for(int i = begin; i < end; i++) {
+		transformedVertices[i] = getTransformedVertex(mesh->firstVertexId + i, transformationMatrix);
+	}
+}
 
-	transformed_vertices.push_back(transformed_vertex_0);
-	transformed_vertices.push_back(transformed_vertex_1);
-	transformed_vertices.push_back(transformed_vertex_2);
+/*
+	Reads the vertex from transformedVertices, or transforms it when the mesh was not
+	transformed as a whole (transformedVertices is empty then).
+*/
+Vec4 Scene::getTransformedVertex(Mesh* mesh, int vertexId, Matrix4& transformationMatrix, std::vector<Vec4>& transformedVertices) {
+	if(transformedVertices.empty()) {
+		return getTransformedVertex(vertexId, transformationMatrix);
+	}
+	return transformedVertices[vertexId - mesh->firstVertexId];
+}
+
+bool Scene::isBackFacing(Vec4& transformed_vertex_0, Vec4& transformed_vertex_1, Vec4& transformed_vertex_2) {
+	Vec3 vertex_0 = Vec3(transformed_vertex_0.x, transformed_vertex_0.y, transformed_vertex_0.z);
+	Vec3 vertex_1 = Vec3(transformed_vertex_1.x, transformed_vertex_1.y, transformed_vertex_1.z);
+	Vec3 vertex_2 = Vec3(transformed_vertex_2.x, transformed_vertex_2.y, transformed_vertex_2.z);
+
+	Vec3 v1_minus_v0 = subtractVec3(vertex_1, vertex_0);
+	Vec3 v2_minus_v0 = subtractVec3(vertex_2, vertex_0);
 
-	return transformed_vertices;
+	Vec3 normal = normalizeVec3(crossProductVec3(v1_minus_v0, v2_minus_v0));
+	return dotProductVec3(normal, vertex_0) < 0;
 }
 
 double f_xy(double x, double y, double x0, double y0, double x1, double y1) {
 	return x * (y0 - y1) + y * (x1 - x0) + (x0 * y1 - y0 * x1);
 }
 
-void Scene::rasterizeTriangle(std::vector<Vec4>& transformed_vertices, std::vector<Color>& triangleVertexColors, Camera* camera, Matrix4& viewportTransformationMatrix, std::vector<std::vector<double>>& depth) {
-	for (int i = 0; i < transformed_vertices.size(); i++) {
+/*
+	Transforms, culls and sets up the triangle for rasterization on a width x height image.
+	Returns false when nothing of the triangle is drawn.
+*/
+bool Scene::setupTriangle(Triangle& triangle, Matrix4& transformationMatrix, Matrix4& viewportTransformationMatrix, int width, int height, ScreenTriangle& screenTriangle) {
+	for(int i = 0; i < 3; i++) {
+		screenTriangle.vertices[i] = getTransformedVertex(triangle.vertexIds[i], transformationMatrix);
+		screenTriangle.colors[i] = *this->colorsOfVertices[triangle.vertexIds[i] - 1];
+	}
+	return setupTransformedTriangle(viewportTransformationMatrix, width, height, screenTriangle);
+}
+
+/*
+	Same, taking the vertices from the transformed vertices of the mesh.
+*/
+bool Scene::setupTriangle(Triangle& triangle, Mesh* mesh, Matrix4& transformationMatrix, std::vector<Vec4>& transformedVertices, Matrix4& viewportTransformationMatrix, int width, int height, ScreenTriangle& screenTriangle) {
+	for(int i = 0; i < 3; i++) {
+		screenTriangle.vertices[i] = getTransformedVertex(mesh, triangle.vertexIds[i], transformationMatrix, transformedVertices);
+		screenTriangle.colors[i] = *this->colorsOfVertices[triangle.vertexIds[i] - 1];
+	}
+	return setupTransformedTriangle(viewportTransformationMatrix, width, height, screenTriangle);
+}
+
+/*
+	Continues the setup of a triangle whose vertices are already transformed and divided
+	by w, and whose colors are filled in. Returns false if it is culled or not visible.
+*/
+bool Scene::setupTransformedTriangle(Matrix4& viewportTransformationMatrix, int width, int height, ScreenTriangle& screenTriangle) {
+	Vec4* transformed_vertices = screenTriangle.vertices;
+
+	// Backface Culling
+	if(this->cullingEnabled && isBackFacing(transformed_vertices[0], transformed_vertices[1], transformed_vertices[2])) {
+		return false;
+	}
+
+	for(int i = 0; i < 3; i++) {
 		transformed_vertices[i] = multiplyMatrixWithVec4(viewportTransformationMatrix, transformed_vertices[i]);
 	}
-	
+
 	double x_min = min(transformed_vertices[0].x, min(transformed_vertices[1].x, transformed_vertices[2].x));
 	double x_max = max(transformed_vertices[0].x, max(transformed_vertices[1].x, transformed_vertices[2].x));
 	double y_min = min(transformed_vertices[0].y, min(transformed_vertices[1].y, transformed_vertices[2].y));
@@ -428,29 +1054,51 @@ void Scene::rasterizeTriangle(std::vector<Vec4>& transformed_vertices, std::vect
 
 	// Clamp coordinates to valid screen space
 	x_min = max(0.0, ceil(x_min));
-	x_max = min(camera->horRes - 1.0, floor(x_max));
+	x_max = min(width - 1.0, floor(x_max));
 	y_min = max(0.0, ceil(y_min));
-	y_max = min(camera->verRes - 1.0, floor(y_max));
+	y_max = min(height - 1.0, floor(y_max));
 
 	// Early exit if triangle is completely outside screen
 	if (x_min > x_max || y_min > y_max) {
-		return;
+		return false;
 	}
 
-	Color color1, color2, color3, color;
-	color1 = triangleVertexColors[0];
-	color2 = triangleVertexColors[1];
-	color3 = triangleVertexColors[2];
-
-	double f01_2 = f_xy(transformed_vertices[2].x, transformed_vertices[2].y, transformed_vertices[0].x, transformed_vertices[0].y, transformed_vertices[1].x, transformed_vertices[1].y);
-	double f12_0 = f_xy(transformed_vertices[0].x, transformed_vertices[0].y, transformed_vertices[1].x, transformed_vertices[1].y, transformed_vertices[2].x, transformed_vertices[2].y);
-	double f20_1 = f_xy(transformed_vertices[1].x, transformed_vertices[1].y, transformed_vertices[2].x, transformed_vertices[2].y, transformed_vertices[0].x, transformed_vertices[0].y);
-	
+	screenTriangle.bounds = Region(x_min, y_min, x_max, y_max);
+
+	screenTriangle.f01_2 = f_xy(transformed_vertices[2].x, transformed_vertices[2].y, transformed_vertices[0].x, transformed_vertices[0].y, transformed_vertices[1].x, transformed_vertices[1].y);
+	screenTriangle.f12_0 = f_xy(transformed_vertices[0].x, transformed_vertices[0].y, transformed_vertices[1].x, transformed_vertices[1].y, transformed_vertices[2].x, transformed_vertices[2].y);
+	screenTriangle.f20_1 = f_xy(transformed_vertices[1].x, transformed_vertices[1].y, transformed_vertices[2].x, transformed_vertices[2].y, transformed_vertices[0].x, transformed_vertices[0].y);
+
 	// Check if triangle is degenerate
-	if (abs(f01_2) < 1e-6 || abs(f12_0) < 1e-6 || abs(f20_1) < 1e-6) {
-		return;
+	if (abs(screenTriangle.f01_2) < 1e-6 || abs(screenTriangle.f12_0) < 1e-6 || abs(screenTriangle.f20_1) < 1e-6) {
+		return false;
 	}
 
+	return true;
+}
+
+/*
+	Rasterizes the part of the triangle that falls into region.
+*/
+void Scene::rasterizeTriangle(ScreenTriangle& screenTriangle, FrameBuffer& frameBuffer, Region& region) {
+	Vec4* transformed_vertices = screenTriangle.vertices;
+	double f01_2 = screenTriangle.f01_2;
+	double f12_0 = screenTriangle.f12_0;
+	double f20_1 = screenTriangle.f20_1;
+
+	int x_min = max(screenTriangle.bounds.xMin, region.xMin);
+	int x_max = min(screenTriangle.bounds.xMax, region.xMax);
+	int y_min = max(screenTriangle.bounds.yMin, region.yMin);
+	int y_max = min(screenTriangle.bounds.yMax, region.yMax);
+
+	long long key = screenTriangle.key;
+	long long* keys = frameBuffer.keepKeys ? &frameBuffer.keys[0] : NULL;
+
+	Color color1, color2, color3, color;
+	color1 = screenTriangle.colors[0];
+	color2 = screenTriangle.colors[1];
+	color3 = screenTriangle.colors[2];
+
 	double alpha, beta, gamma;
 	for(int y = y_min; y <= y_max; y++) {
 		for(int x = x_min; x <= x_max; x++) {
@@ -460,206 +1108,240 @@ void Scene::rasterizeTriangle(std::vector<Vec4>& transformed_vertices, std::vect
 
 				if(alpha >= 0 && beta >= 0 && gamma >= 0) {
 					double z_value = alpha * transformed_vertices[0].z + beta * transformed_vertices[1].z + gamma * transformed_vertices[2].z;
-					if(z_value < depth[x][y]) {
-						depth[x][y] = z_value;
+					int index = (y - frameBuffer.rowOffset) * frameBuffer.width + x;
+					if(z_value < frameBuffer.depths[index] || (keys != NULL && z_value == frameBuffer.depths[index] && key < keys[index])) {
+						frameBuffer.depths[index] = z_value;
+						if(keys != NULL) keys[index] = key;
 						color = Color(alpha * color1.r + beta * color2.r + gamma * color3.r, 
 									alpha * color1.g + beta * color2.g + gamma * color3.g, 
 									alpha * color1.b + beta * color2.b + gamma * color3.b);
-						this->image[x][y] = color;
+						frameBuffer.colors[index] = color;
 					}
 				}
 		}
 	}
 }
 
-bool Scene::visible(double den, double num, double& tEnter, double& tLeave) {
-	if(den > 0) { // potentially entering
-		double t = num / den;
-		if(t > tLeave) return false;
-		if(t > tEnter) tEnter = t;
-	}
-	else if(den < 0) { // potentially leaving
-		double t = num / den;
-		if(t < tEnter) return false;
-		if(t < tLeave) tLeave = t;
-	}
-	else if(num > 0) return false; // parallel
-	return true;
+/*
+	Rounds a viewport coordinate to the nearest pixel. Clipping keeps end points in
+	[-0.5, maxPixel + 0.5], which round to [-1, maxPixel + 1]; the clamp to that range
+	only matters for NaN coordinates and never moves a clipped end point.
+*/
+static int toPixel(double value, int maxPixel) {
+	value = min(maxPixel + 1.0, max(-1.0, value));
+	return (int)round(value);
 }
 
-bool Scene::clip_line(std::vector<Vec4>& vertices, std::vector<Color>& colors, Matrix4& viewportTransformationMatrix) {
-	double tEnter = 0.0;
-	double tLeave = 1.0;
-
-	Vec4 v0 = vertices[0];
-	Vec4 v1 = vertices[1];
-
-	Color color_v0 = colors[0];
-	Color color_v1 = colors[1];
-
-	double dx = v1.x - v0.x;
-	double dy = v1.y - v0.y;
-	double dz = v1.z - v0.z;
-
-	bool is_visible = false;
-	if(visible(dx, (-1 - v0.x), tEnter, tLeave)) { // left 
-		if(visible(-dx, (v0.x - 1), tEnter, tLeave)) { // right
-			if(visible(dy, (-1 - v0.y), tEnter, tLeave)) { // bottom
-				if(visible(-dy, (v0.y - 1), tEnter, tLeave)) { // top
-					if(visible(dz, (-1 - v0.z), tEnter, tLeave)) { // back
-						if(visible(-dz, (v0.z - 1), tEnter, tLeave)) { // front
-							is_visible = true;
-							if(tLeave < 1) {
-								v1.x = v0.x + dx*tLeave;
-								v1.y = v0.y + dy*tLeave;
-								v1.z = v0.z + dz*tLeave;
-
-								colors[1] = Color(color_v0.r + (color_v1.r - color_v0.r) * tLeave, 
-													color_v0.g + (color_v1.g - color_v0.g) * tLeave, 
-													color_v0.b + (color_v1.b - color_v0.b) * tLeave);
-							}
-							if(tEnter > 0) {
-								v0.x = v0.x + dx*tEnter;
-								v0.y = v0.y + dy*tEnter;
-								v0.z = v0.z + dz*tEnter;
-
-								colors[0] = Color(color_v0.r + (color_v1.r - color_v0.r) * tEnter, 
-													color_v0.g + (color_v1.g - color_v0.g) * tEnter, 
-													color_v0.b + (color_v1.b - color_v0.b) * tEnter);
-							}
-						}
-					}
-				}
-			}
-		}
+/*
+	Sets up a clipped line for Bresenham drawing on a width x height image.
+	The rounded end points may lie one pixel outside the image, the line keeps its
+	slope and rasterizeLine skips the steps outside the frame buffer. The bounds are
+	cut to the image.
+*/
+void Scene::setupLine(Line& line, Matrix4& viewportTransformationMatrix, int width, int height, ScreenLine& screenLine) {
+	// Apply viewport transformation after clipping
+	Vec4 v0 = multiplyMatrixWithVec4(viewportTransformationMatrix, line.vertices[0]);
+	Vec4 v1 = multiplyMatrixWithVec4(viewportTransformationMatrix, line.vertices[1]);
+	Color c0 = line.colors[0];
+	Color c1 = line.colors[1];
+
+	int x0 = toPixel(v0.x, width - 1);
+	int y0 = toPixel(v0.y, height - 1);
+	int x1 = toPixel(v1.x, width - 1);
+	int y1 = toPixel(v1.y, height - 1);
+
+	int dx = abs(x1 - x0);
+	int dy = abs(y1 - y0);
+
+	// step along x for horizontal-ish lines, along y for vertical-ish lines
+	bool xMajor = dx >= dy;
+	if(xMajor ? x0 > x1 : y0 > y1) {
+		std::swap(x0, x1);
+		std::swap(y0, y1);
+		std::swap(v0, v1);
+		std::swap(c0, c1);
 	}
 
-	return is_visible;
+	screenLine.x0 = x0;
+	screenLine.y0 = y0;
+	screenLine.x1 = x1;
+	screenLine.y1 = y1;
+	screenLine.xMajor = xMajor;
+	screenLine.steps = xMajor ? dx : dy;
+	screenLine.minorSteps = xMajor ? dy : dx;
+	screenLine.bounds = Region(max(min(x0, x1), 0), max(min(y0, y1), 0), min(max(x0, x1), width - 1), min(max(y0, y1), height - 1));
+
+	double inverseSteps = screenLine.steps == 0 ? 0 : 1.0 / screenLine.steps;
+	screenLine.z = v0.z;
+	screenLine.r = c0.r;
+	screenLine.g = c0.g;
+	screenLine.b = c0.b;
+	screenLine.zStep = (v1.z - v0.z) * inverseSteps;
+	screenLine.rStep = (c1.r - c0.r) * inverseSteps;
+	screenLine.gStep = (c1.g - c0.g) * inverseSteps;
+	screenLine.bStep = (c1.b - c0.b) * inverseSteps;
 }
 
-void Scene::rasterizeLine(bool clipped, std::vector<Vec4>& vertices, std::vector<Color>& colors, Matrix4& viewportTransformationMatrix, std::vector<std::vector<double>>& depth) {
-	if(!clipped) return;
-	
-	// Apply viewport transformation after clipping
-	vertices[0] = multiplyMatrixWithVec4(viewportTransformationMatrix, vertices[0]);
-	vertices[1] = multiplyMatrixWithVec4(viewportTransformationMatrix, vertices[1]);
+static long long floorDivide(long long a, long long b) {
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
 
-	int x0 = round(vertices[0].x);
-	int y0 = round(vertices[0].y);
-	int x1 = round(vertices[1].x);
-	int y1 = round(vertices[1].y);
+/*
+	Bresenham line drawing restricted to region. Depth and color come from constant
+	increments along the major axis and are written straight into the frame buffer.
+	Instead of testing every pixel against the region, the first and last steps inside it
+	are computed up front and the walk starts there, with the decision variable it would
+	have had after stepping from the first end point. The drawn pixels and values are the
+	same whichever region the line is split into.
+*/
+void Scene::rasterizeLine(ScreenLine& line, FrameBuffer& frameBuffer, Region& region) {
+	bool xMajor = line.xMajor;
+	long long steps = line.steps;
+	long long minorSteps = line.minorSteps;
+	int majorStart = xMajor ? line.x0 : line.y0;
+	int minorStart = xMajor ? line.y0 : line.x0;
+	int minorEnd = xMajor ? line.y1 : line.x1;
+	int majorMin = xMajor ? region.xMin : region.yMin;
+	int majorMax = xMajor ? region.xMax : region.yMax;
+	int minorMin = xMajor ? region.yMin : region.xMin;
+	int minorMax = xMajor ? region.yMax : region.xMax;
+
+	// steps whose major coordinate is inside the region
+	long long first = max(0LL, (long long)majorMin - majorStart);
+	long long last = min(steps, (long long)majorMax - majorStart);
+
+	// the minor coordinate after k steps is minorStart +- n(k), n(k) = floor((2 * minorSteps * k + steps) / (2 * steps))
+	int minorDirection = minorEnd >= minorStart ? 1 : -1;
+	long long nMin = minorDirection > 0 ? minorMin - minorStart : minorStart - minorMax;
+	long long nMax = minorDirection > 0 ? minorMax - minorStart : minorStart - minorMin;
+
+	if(minorSteps == 0) {
+		if(nMin > 0 || nMax < 0) return;
+	}
+	else {
+		if(nMin > 0) first = max(first, -floorDivide(-(2 * steps * nMin - steps), 2 * minorSteps));
+		last = min(last, floorDivide(2 * steps * (nMax + 1) - steps - 1, 2 * minorSteps));
+	}
 
-	int dx = abs(x1 - x0);
-	int dy = abs(y1 - y0);
-	double m = dx == 0 ? INFINITY : (double)(y1 - y0) / (x1 - x0);
-
-	if(abs(m) <= 1) {
-		// Handle horizontal-ish lines
-		if(x0 > x1) {
-			std::swap(x0, x1);
-			std::swap(y0, y1);
-			std::swap(colors[0], colors[1]);
-			std::swap(vertices[0].z, vertices[1].z);
-		}
-		
-		int y = y0;
-		int d = 2*dy - dx;
-		int increment = (y1 > y0) ? 1 : -1;
-		
-		for(int x = x0; x <= x1; x++) {
-			if(x >= 0 && x < depth.size() && y >= 0 && y < depth[0].size()) {
-				double t = dx == 0 ? 0 : (double)(x - x0) / dx;
-				double z = vertices[0].z * (1-t) + vertices[1].z * t;
-				
-				if(z < depth[x][y]) {
-					depth[x][y] = z;
-					Color color = Color(
-						colors[0].r * (1-t) + colors[1].r * t,
-						colors[0].g * (1-t) + colors[1].g * t,
-						colors[0].b * (1-t) + colors[1].b * t
-					);
-					this->image[x][y] = color;
-				}
-			}
-			
-			if(d < 0) {
-				d += 2*dy;
-			} else {
-				y += increment;
-				d += 2*(dy - dx);
-			}
+	if(first > last) return;
+
+	long long n = steps == 0 ? 0 : (2 * minorSteps * first + steps) / (2 * steps);
+	long long d = 2 * minorSteps * (first + 1) - steps - 2 * steps * n;
+
+	int majorIncrement = xMajor ? 1 : frameBuffer.width;
+	int minorIncrement = xMajor ? minorDirection * frameBuffer.width : minorDirection;
+	int x = xMajor ? majorStart + first : minorStart + minorDirection * n;
+	int y = xMajor ? minorStart + minorDirection * n : majorStart + first;
+
+	Color* colors = &frameBuffer.colors[0];
+	double* depths = &frameBuffer.depths[0];
+	long long* keys = frameBuffer.keepKeys ? &frameBuffer.keys[0] : NULL;
+	int index = (y - frameBuffer.rowOffset) * frameBuffer.width + x;
+
+	for(long long k = first; k <= last; k++) {
+		double z = line.z + k * line.zStep;
+
+		if(z < depths[index] || (keys != NULL && z == depths[index] && line.key < keys[index])) {
+			depths[index] = z;
+			if(keys != NULL) keys[index] = line.key;
+			colors[index].r = line.r + k * line.rStep;
+			colors[index].g = line.g + k * line.gStep;
+			colors[index].b = line.b + k * line.bStep;
 		}
-	} else {
-		// Handle vertical-ish lines
-		if(y0 > y1) {
-			std::swap(x0, x1);
-			std::swap(y0, y1);
-			std::swap(colors[0], colors[1]);
-			std::swap(vertices[0].z, vertices[1].z);
-		}
-		
-		int x = x0;
-		int d = 2*dx - dy;
-		int increment = (x1 > x0) ? 1 : -1;
-		
-		for(int y = y0; y <= y1; y++) {
-			if(x >= 0 && x < depth.size() && y >= 0 && y < depth[0].size()) {
-				double t = dy == 0 ? 0 : (double)(y - y0) / dy;
-				double z = vertices[0].z * (1-t) + vertices[1].z * t;
-				
-				if(z < depth[x][y]) {
-					depth[x][y] = z;
-					Color color = Color(
-						colors[0].r * (1-t) + colors[1].r * t,
-						colors[0].g * (1-t) + colors[1].g * t,
-						colors[0].b * (1-t) + colors[1].b * t
-					);
-					this->image[x][y] = color;
-				}
-			}
-			
-			if(d < 0) {
-				d += 2*dx;
-			} else {
-				x += increment;
-				d += 2*(dx - dy);
-			}
+
+		index += majorIncrement;
+		if(d < 0) {
+			d += 2 * minorSteps;
+		} else {
+			index += minorIncrement;
+			d += 2 * (minorSteps - steps);
 		}
 	}
 }
 
-void Scene::processWireframeMesh(std::vector<Vec4>& transformed_vertices, std::vector<Color>& triangleVertexColors, Camera* camera, Matrix4& viewportTransformationMatrix, std::vector<std::vector<double>>& depth) {
-	bool clipped_line0_v0_to_v1;
-	bool clipped_line1_v1_to_v2;
-	bool clipped_line2_v2_to_v0;
-	
-	// first line to clip -> v0 to v1
-	std::vector<Vec4> line0_vertices = copyVec4(transformed_vertices, 0, 1);
-	std::vector<Color> line0_colors = copyColor(triangleVertexColors, 0, 1);
-	clipped_line0_v0_to_v1 = clip_line(line0_vertices, line0_colors, viewportTransformationMatrix);
+/*
+	Clips the lines collected in the batch and sets up the visible parts for rasterization,
+	in the order they were added. Returns the number of lines written to screenLines.
+*/
+int Scene::setupLineBatch(LineBatch& batch, Matrix4& viewportTransformationMatrix, int width, int height, ScreenLine* screenLines) {
+	Line clippedLines[LINE_BATCH_SIZE];
+	int visibleCount = batch.clip(clippedLines);
 
-	// second line to clip -> v1 to v2
-	std::vector<Vec4> line1_vertices = copyVec4(transformed_vertices, 1, 2);
-	std::vector<Color> line1_colors = copyColor(triangleVertexColors, 1, 2);
-	clipped_line1_v1_to_v2 = clip_line(line1_vertices, line1_colors, viewportTransformationMatrix);
+	for(int i = 0; i < visibleCount; i++) {
+		setupLine(clippedLines[i], viewportTransformationMatrix, width, height, screenLines[i]);
+	}
+	return visibleCount;
+}
 
-	// third line to clip -> v2 to v0
-	std::vector<Vec4> line2_vertices = copyVec4(transformed_vertices, 2, 0);
-	std::vector<Color> line2_colors = copyColor(triangleVertexColors, 2, 0);
-	clipped_line2_v2_to_v0 = clip_line(line2_vertices, line2_colors, viewportTransformationMatrix);
+/*
+	Clips the lines collected in the batch and rasterizes the visible parts in the order they were added.
+*/
+void Scene::rasterizeLineBatch(LineBatch& batch, Matrix4& viewportTransformationMatrix, FrameBuffer& frameBuffer) {
+	ScreenLine screenLines[LINE_BATCH_SIZE];
+	int visibleCount = setupLineBatch(batch, viewportTransformationMatrix, frameBuffer.width, frameBuffer.height, screenLines);
+	Region image(0, 0, frameBuffer.width - 1, frameBuffer.height - 1);
 
-	rasterizeLine(clipped_line0_v0_to_v1, line0_vertices, line0_colors, viewportTransformationMatrix, depth);
-	rasterizeLine(clipped_line1_v1_to_v2, line1_vertices, line1_colors, viewportTransformationMatrix, depth);
-	rasterizeLine(clipped_line2_v2_to_v0, line2_vertices, line2_colors, viewportTransformationMatrix, depth);
+	for(int i = 0; i < visibleCount; i++) {
+		rasterizeLine(screenLines[i], frameBuffer, image);
+	}
 }
 
 /*
-	T"r"ansformations, clipping, culling, rasterization are done here.
+	Fills frontFacing[i] for the triangles i in [begin, end) of the mesh.
 */
-void Scene::forwardRenderingPipeline(Camera *camera)
-{
-	std::vector<std::vector<double>> depth(camera->horRes, std::vector<double>(camera->verRes, MAX_DEPTH));
-	// ***** Viewing Transformation ***** //
+void Scene::computeFrontFacing(Mesh* mesh, Matrix4& transformationMatrix, std::vector<Vec4>& transformedVertices, int begin, int end, std::vector<char>& frontFacing) {
+	for(int i = begin; i < end; i++) {
+		Triangle& triangle = mesh->triangles[i];
+		Vec4 transformed_vertex_0 = getTransformedVertex(mesh, triangle.vertexIds[0], transformationMatrix, transformedVertices);
+		Vec4 transformed_vertex_1 = getTransformedVertex(mesh, triangle.vertexIds[1], transformationMatrix, transformedVertices);
+		Vec4 transformed_vertex_2 = getTransformedVertex(mesh, triangle.vertexIds[2], transformationMatrix, transformedVertices);
+		frontFacing[i] = !isBackFacing(transformed_vertex_0, transformed_vertex_1, transformed_vertex_2);
+	}
+}
+
+/*
+	An edge is culled only when culling is enabled and every triangle sharing it is back facing.
+*/
+bool Scene::isEdgeVisible(Edge& edge, std::vector<char>& frontFacing) {
+	if(!this->cullingEnabled) return true;
+
+	bool visible_from_first = frontFacing[edge.triangleIds[0]];
+	bool visible_from_second = edge.triangleIds[1] != NO_TRIANGLE && frontFacing[edge.triangleIds[1]];
+	return visible_from_first || visible_from_second;
+}
+
+/*
+	Draws the unique edges of a wireframe mesh. frontFacing is scratch space for the
+	back face flags, kept by the caller so that its memory is reused across meshes.
+*/
+void Scene::processWireframeMesh(Mesh* mesh, Matrix4& transformationMatrix, std::vector<Vec4>& transformedVertices, std::vector<char>& frontFacing, Matrix4& viewportTransformationMatrix, FrameBuffer& frameBuffer) {
+	frontFacing.clear();
+
+	if(this->cullingEnabled) {
+		frontFacing.resize(mesh->triangles.size());
+		computeFrontFacing(mesh, transformationMatrix, transformedVertices, 0, mesh->triangles.size(), frontFacing);
+	}
+
+	LineBatch batch;
+	for(Edge& edge : mesh->edges) {
+		if(!isEdgeVisible(edge, frontFacing)) continue;
+
+		Vec4 transformed_vertex_0 = getTransformedVertex(mesh, edge.vertexIds[0], transformationMatrix, transformedVertices);
+		Vec4 transformed_vertex_1 = getTransformedVertex(mesh, edge.vertexIds[1], transformationMatrix, transformedVertices);
+		batch.add(transformed_vertex_0, transformed_vertex_1, *this->colorsOfVertices[edge.vertexIds[0] - 1], *this->colorsOfVertices[edge.vertexIds[1] - 1]);
+
+		if(batch.isFull()) {
+			rasterizeLineBatch(batch, viewportTransformationMatrix, frameBuffer);
+		}
+	}
+	rasterizeLineBatch(batch, viewportTransformationMatrix, frameBuffer);
+}
+
+/*
+	Composes modeling, camera and projection transformations of the mesh.
+*/
+Matrix4 Scene::getTransformationMatrix(Mesh* mesh, Camera* camera) {
+	Matrix4 modelingTransformationMatrix = mesh->modelingTransformation;
 
 	// Camera Transformation
 	Matrix4 cameraTransformationMatrix = camera->getCameraTransformationMatrix();
@@ -667,47 +1349,69 @@ void Scene::forwardRenderingPipeline(Camera *camera)
 	// Projection Transformation
 	Matrix4 projectionTransformationMatrix = camera->getProjectionTransformationMatrix();
 
-	// Viewport Transformation
-	Matrix4 viewportTransformationMatrix = camera->getViewportTransformationMatrix();
+	Matrix4 transformationMatrix = multiplyMatrixWithMatrix(cameraTransformationMatrix, modelingTransformationMatrix);
+	return multiplyMatrixWithMatrix(projectionTransformationMatrix, transformationMatrix);
+}
 
-	// ***** End of Viewing Transformation ***** //
+/*
+	T"r"ansformations, clipping, culling, rasterization are done here.
+*/
+void Scene::forwardRenderingPipeline(Camera *camera)
+{
+	forwardRenderingPipeline(camera, this->frameBuffer);
+}
 
-	Matrix4 modelingTransformationMatrix = getIdentityMatrix();
-	for(Mesh* mesh : this->meshes) {
-		modelingTransformationMatrix = getModelingTransformationMatrix(mesh);
+/*
+	Renders into the given frame buffer, using the scene's scratch space.
+*/
+void Scene::forwardRenderingPipeline(Camera *camera, FrameBuffer &frameBuffer)
+{
+	forwardRenderingPipeline(camera, frameBuffer, this->transformedVertices, this->frontFacing);
+}
 
-		// compose transformation matrix
-		Matrix4 transformationMatrix = multiplyMatrixWithMatrix(cameraTransformationMatrix, modelingTransformationMatrix);
-		transformationMatrix = multiplyMatrixWithMatrix(projectionTransformationMatrix, transformationMatrix);
+/*
+	Renders into the given frame buffer with the given scratch space. The scene is only
+	read, so several cameras can be rendered at the same time into separate frame buffers
+	with separate scratch space. Once the frame buffer and the scratch space have grown to
+	the camera and the largest mesh, rendering allocates nothing.
+*/
+void Scene::forwardRenderingPipeline(Camera *camera, FrameBuffer &frameBuffer, std::vector<Vec4> &transformedVertices, std::vector<char> &frontFacing)
+{
+	frameBuffer.resize(camera->horRes, camera->verRes);
+	frameBuffer.clearDepth();
 
-		for(Triangle& triangle : mesh->triangles) {
-			vector<Vec4> transformed_vertices = getTransformedTriangleVertices(triangle, transformationMatrix, this->vertices);
+	// Viewport Transformation
+	Matrix4 viewportTransformationMatrix = camera->getViewportTransformationMatrix();
 
-			// Backface Culling
-			if(this->cullingEnabled) {
-				Vec3 vertex_0 = Vec3(transformed_vertices[0].x, transformed_vertices[0].y, transformed_vertices[0].z);
-				Vec3 vertex_1 = Vec3(transformed_vertices[1].x, transformed_vertices[1].y, transformed_vertices[1].z);
-				Vec3 vertex_2 = Vec3(transformed_vertices[2].x, transformed_vertices[2].y, transformed_vertices[2].z);
+	// scratch space shared by the meshes, sized for the largest one so that it grows once
+	size_t largestRange = 0;
+	for(Mesh* mesh : this->meshes) {
+		if(mesh->hasCompactVertexRange()) {
+			largestRange = max(largestRange, (size_t)(mesh->lastVertexId - mesh->firstVertexId + 1));
+		}
+	}
+	transformedVertices.reserve(largestRange);
 
-				Vec3 v1_minus_v0 = subtractVec3(vertex_1, vertex_0);
-				Vec3 v2_minus_v0 = subtractVec3(vertex_2, vertex_0);
+	Region image(0, 0, frameBuffer.width - 1, frameBuffer.height - 1);
+	ScreenTriangle screenTriangle;
+	for(Mesh* mesh : this->meshes) {
+		Matrix4 transformationMatrix = getTransformationMatrix(mesh, camera);
 
-				Vec3 normal = normalizeVec3(crossProductVec3(v1_minus_v0, v2_minus_v0));
-				if(dotProductVec3(normal, vertex_0) < 0) continue;
-			}
+		transformedVertices.clear();
+		if(mesh->hasCompactVertexRange()) {
+			transformedVertices.resize(mesh->lastVertexId - mesh->firstVertexId + 1);
+			transformVertices(mesh, transformationMatrix, 0, transformedVertices.size(), transformedVertices);
+		}
 
-			vector<Color> triangleVertexColors;
-			for(int i = 0; i < 3; i++) {
-				triangleVertexColors.push_back(*this->colorsOfVertices[triangle.vertexIds[i] - 1]);
-			}
+		if (mesh->type == WIREFRAME_MESH) {
+			processWireframeMesh(mesh, transformationMatrix, transformedVertices, frontFacing, viewportTransformationMatrix, frameBuffer);
+			continue;
+		}
 
-			if (mesh->type == SOLID_MESH){
-				rasterizeTriangle(transformed_vertices, triangleVertexColors, camera, viewportTransformationMatrix, depth);
-			}
-			else if (mesh->type == WIREFRAME_MESH) {
-				processWireframeMesh(transformed_vertices, triangleVertexColors, camera, viewportTransformationMatrix, depth);
+		for(Triangle& triangle : mesh->triangles) {
+			if(setupTriangle(triangle, mesh, transformationMatrix, transformedVertices, viewportTransformationMatrix, frameBuffer.width, frameBuffer.height, screenTriangle)) {
+				rasterizeTriangle(screenTriangle, frameBuffer, image);
 			}
 		}
 	}
-
 }
@@ -1,5 +1,11 @@
 #ifndef _SCENE_H_
 #define _SCENE_H_
+#define PPM_STRIP_ROWS 64
+#define OUTPUT_PPM_ASCII 0
+#define OUTPUT_PPM_BINARY 1
+#define OUTPUT_PNG 2
+#define OUTPUT_QOI 3
+#define OUTPUT_BY_EXTENSION -1
 #include <vector>
 #include "Vec3.h"
 #include "Vec4.h"
@@ -9,6 +15,16 @@
 #include "Translation.h"
 #include "Camera.h"
 #include "Mesh.h"
+#include "Line.h"
+#include "LineBatch.h"
+#include "FrameBuffer.h"
+#include "Region.h"
+#include "ScreenTriangle.h"
+#include "ScreenLine.h"
+#include "ThreadPool.h"
+#include "Arena.h"
+#include "VideoWriter.h"
+#include "FileStatus.h"
 #include "Helpers.h"
 
 class Scene
@@ -16,8 +32,10 @@ class Scene
 public:
 	Color backgroundColor;
 	bool cullingEnabled;
+	int outputFormat; // one of the OUTPUT_ values, OUTPUT_BY_EXTENSION picks the format from the output file name
+	VideoWriter *videoWriter; // when set, images become frames of its stream instead of files
 
-	std::vector<std::vector<Color> > image;
+	FrameBuffer frameBuffer;
 	std::vector<Camera *> cameras;
 	std::vector<Vec3 *> vertices;
 	std::vector<Color *> colorsOfVertices;
@@ -25,21 +43,63 @@ public:
 	std::vector<Rotation *> rotations;
 	std::vector<Translation *> translations;
 	std::vector<Mesh *> meshes;
+	Arena arena; // owns the objects the vectors above point to
+	FileStatus sourceFile; // the XML file the scene was parsed from, as it was before reading it
+	std::vector<FileStatus> importedFiles; // the OBJ and PLY files of the meshes, as they were when read
 
+	// scratch space of forwardRenderingPipeline, kept between renders so that rendering allocates nothing once it has grown
+	std::vector<Vec4> transformedVertices;
+	std::vector<char> frontFacing;
+
+	Scene();
 	Scene(const char *xmlPath);
+	~Scene();
+
+	bool loadXMLStream(const char *xmlPath);
+	void loadXMLDocument(const char *xmlPath);
+	void importMeshFiles(const char *xmlPath);
+	void clear();
 
 	void initializeImage(Camera *camera);
+	void initializeImage(Camera *camera, FrameBuffer &frameBuffer);
 	int makeBetweenZeroAnd255(double value);
 	void writeImageToPPMFile(Camera *camera);
+	void writeImageToPPMFile(Camera *camera, FrameBuffer &frameBuffer);
+	void writeImageToPPMFile(Camera *camera, FrameBuffer &frameBuffer, ThreadPool *pool);
+	void writeImageToBinaryPPMFile(Camera *camera, FrameBuffer &frameBuffer);
+	void writeImageToPNGFile(Camera *camera, FrameBuffer &frameBuffer);
+	void writeImageToQOIFile(Camera *camera, FrameBuffer &frameBuffer);
+	std::string getOutputPath(Camera *camera, const char *extension);
+	int getOutputFormat(Camera *camera);
+	void writeImage(Camera *camera, FrameBuffer &frameBuffer);
+	void writeImage(Camera *camera, FrameBuffer &frameBuffer, ThreadPool *pool);
 	void convertPPMToPNG(std::string ppmFileName, int osType);
 	Matrix4 getModelingTransformationMatrix(Mesh* mesh);
-	std::vector<Vec4> getTransformedTriangleVertices(Triangle& triangle, Matrix4& transformationMatrix, std::vector<Vec3 *>& vertices);
-	void rasterizeTriangle(std::vector<Vec4>& transformed_vertices, std::vector<Color>& triangleVertexColors, Camera* camera, Matrix4& viewportTransformationMatrix, std::vector<std::vector<double>>& depth);
-	void processWireframeMesh(std::vector<Vec4>& transformed_vertices, std::vector<Color>& triangleVertexColors, Camera* camera, Matrix4& viewportTransformationMatrix, std::vector<std::vector<double>>& depth);
-	bool visible(double den, double num, double& tEnter, double& tLeave);
-	void rasterizeLine(bool clipped, std::vector<Vec4>& vertices, std::vector<Color>& colors, Matrix4& viewportTransformationMatrix, std::vector<std::vector<double>>& depth);
-	bool clip_line(std::vector<Vec4>& vertices, std::vector<Color>& colors, Matrix4& viewportTransformationMatrix);
+	void updateModelingTransformations();
+	void setTransformation(char type, int transformationId, double* values);
+	Matrix4 getTransformationMatrix(Mesh* mesh, Camera* camera);
+	Vec4 getTransformedVertex(int vertexId, Matrix4& transformationMatrix);
+	void transformVertices(Mesh* mesh, Matrix4& transformationMatrix, int begin, int end, std::vector<Vec4>& transformedVertices);
+	Vec4 getTransformedVertex(Mesh* mesh, int vertexId, Matrix4& transformationMatrix, std::vector<Vec4>& transformedVertices);
+	bool isBackFacing(Vec4& transformed_vertex_0, Vec4& transformed_vertex_1, Vec4& transformed_vertex_2);
+	bool setupTriangle(Triangle& triangle, Matrix4& transformationMatrix, Matrix4& viewportTransformationMatrix, int width, int height, ScreenTriangle& screenTriangle);
+	bool setupTriangle(Triangle& triangle, Mesh* mesh, Matrix4& transformationMatrix, std::vector<Vec4>& transformedVertices, Matrix4& viewportTransformationMatrix, int width, int height, ScreenTriangle& screenTriangle);
+	bool setupTransformedTriangle(Matrix4& viewportTransformationMatrix, int width, int height, ScreenTriangle& screenTriangle);
+	void rasterizeTriangle(ScreenTriangle& screenTriangle, FrameBuffer& frameBuffer, Region& region);
+	void computeFrontFacing(Mesh* mesh, Matrix4& transformationMatrix, std::vector<Vec4>& transformedVertices, int begin, int end, std::vector<char>& frontFacing);
+	bool isEdgeVisible(Edge& edge, std::vector<char>& frontFacing);
+	void processWireframeMesh(Mesh* mesh, Matrix4& transformationMatrix, std::vector<Vec4>& transformedVertices, std::vector<char>& frontFacing, Matrix4& viewportTransformationMatrix, FrameBuffer& frameBuffer);
+	void setupLine(Line& line, Matrix4& viewportTransformationMatrix, int width, int height, ScreenLine& screenLine);
+	void rasterizeLine(ScreenLine& line, FrameBuffer& frameBuffer, Region& region);
+	int setupLineBatch(LineBatch& batch, Matrix4& viewportTransformationMatrix, int width, int height, ScreenLine* screenLines);
+	void rasterizeLineBatch(LineBatch& batch, Matrix4& viewportTransformationMatrix, FrameBuffer& frameBuffer);
 	void forwardRenderingPipeline(Camera *camera);
+	void forwardRenderingPipeline(Camera *camera, FrameBuffer &frameBuffer);
+	void forwardRenderingPipeline(Camera *camera, FrameBuffer &frameBuffer, std::vector<Vec4> &transformedVertices, std::vector<char> &frontFacing);
+
+private:
+	Scene(const Scene &other);
+	Scene &operator=(const Scene &other);
 };
 
 #endif
\ No newline at end of file
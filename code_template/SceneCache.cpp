@@ -0,0 +1,481 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "SceneCache.h"
+#include "MappedFile.h"
+#include "Scene.h"
+
+using namespace std;
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + SCENE_CACHE_ALIGNMENT - 1) / SCENE_CACHE_ALIGNMENT * SCENE_CACHE_ALIGNMENT;
+}
+
+/*
+    Fills the record of a file the scene was read from, appending its path to the strings block.
+*/
+static void writeFileRecord(const FileStatus &status, SceneCacheImportedFile &record, string &strings)
+{
+    record.pathOffset = strings.size();
+    record.pathLength = status.path.size();
+    record.modificationTime = status.modificationTime;
+    record.size = status.size;
+    strings += status.path;
+}
+
+/*
+    Appends size bytes at the next aligned offset of the file and returns that offset.
+*/
+static uint64_t append(vector<char> &file, const void *data, size_t size)
+{
+    uint64_t offset = alignOffset(file.size());
+
+    file.resize(offset + size);
+    if (size > 0)
+    {
+        memcpy(&file[offset], data, size);
+    }
+    return offset;
+}
+
+static void copyVec3(const Vec3 &vector, double *values)
+{
+    values[0] = vector.x;
+    values[1] = vector.y;
+    values[2] = vector.z;
+}
+
+static Vec3 readVec3(const double *values)
+{
+    return Vec3(values[0], values[1], values[2]);
+}
+
+bool isSceneCacheFile(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    char magic[8];
+    uint32_t version[2];
+    bool isCache = fread(magic, 1, 8, file) == 8 && memcmp(magic, SCENE_CACHE_MAGIC, 8) == 0 &&
+                   fread(version, 4, 2, file) == 2 && version[0] == SCENE_CACHE_VERSION && version[1] == SCENE_CACHE_BYTE_ORDER;
+    fclose(file);
+    return isCache;
+}
+
+bool writeSceneCache(Scene *scene, const char *path)
+{
+    SceneCacheHeader header;
+    vector<char> file(sizeof(SceneCacheHeader));
+    string strings;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCENE_CACHE_MAGIC, 8);
+    header.version = SCENE_CACHE_VERSION;
+    header.byteOrder = SCENE_CACHE_BYTE_ORDER;
+    header.backgroundColor[0] = scene->backgroundColor.r;
+    header.backgroundColor[1] = scene->backgroundColor.g;
+    header.backgroundColor[2] = scene->backgroundColor.b;
+    header.cullingEnabled = scene->cullingEnabled;
+
+    vector<SceneCacheCamera> cameras(scene->cameras.size());
+    for (int i = 0; i < cameras.size(); i++)
+    {
+        Camera *camera = scene->cameras[i];
+        SceneCacheCamera &record = cameras[i];
+
+        record.cameraId = camera->cameraId;
+        record.projectionType = camera->projectionType;
+        record.horRes = camera->horRes;
+        record.verRes = camera->verRes;
+        copyVec3(camera->position, record.position);
+        copyVec3(camera->gaze, record.gaze);
+        copyVec3(camera->u, record.u);
+        copyVec3(camera->v, record.v);
+        copyVec3(camera->w, record.w);
+        record.left = camera->left;
+        record.right = camera->right;
+        record.bottom = camera->bottom;
+        record.top = camera->top;
+        record.near = camera->near;
+        record.far = camera->far;
+        record.outputNameOffset = strings.size();
+        record.outputNameLength = camera->outputFilename.size();
+        strings += camera->outputFilename;
+    }
+    header.cameraCount = cameras.size();
+    header.camerasOffset = append(file, cameras.data(), cameras.size() * sizeof(SceneCacheCamera));
+
+    // structure of arrays, so that a pass over one coordinate reads contiguous memory
+    int vertexCount = scene->vertices.size();
+    vector<double> components(vertexCount);
+    header.vertexCount = vertexCount;
+
+    for (int k = 0; k < 3; k++)
+    {
+        for (int i = 0; i < vertexCount; i++)
+        {
+            components[i] = k == 0 ? scene->vertices[i]->x : k == 1 ? scene->vertices[i]->y : scene->vertices[i]->z;
+        }
+        header.vertexOffsets[k] = append(file, components.data(), vertexCount * sizeof(double));
+    }
+    for (int k = 0; k < 3; k++)
+    {
+        for (int i = 0; i < vertexCount; i++)
+        {
+            Color *color = scene->colorsOfVertices[i];
+            components[i] = k == 0 ? color->r : k == 1 ? color->g : color->b;
+        }
+        header.colorOffsets[k] = append(file, components.data(), vertexCount * sizeof(double));
+    }
+
+    vector<SceneCacheTransformation> transformations(scene->translations.size());
+    for (int i = 0; i < transformations.size(); i++)
+    {
+        Translation *translation = scene->translations[i];
+        SceneCacheTransformation record = {translation->translationId, 0, {translation->tx, translation->ty, translation->tz, 0}};
+        transformations[i] = record;
+    }
+    header.translationCount = transformations.size();
+    header.translationsOffset = append(file, transformations.data(), transformations.size() * sizeof(SceneCacheTransformation));
+
+    transformations.resize(scene->scalings.size());
+    for (int i = 0; i < transformations.size(); i++)
+    {
+        Scaling *scaling = scene->scalings[i];
+        SceneCacheTransformation record = {scaling->scalingId, 0, {scaling->sx, scaling->sy, scaling->sz, 0}};
+        transformations[i] = record;
+    }
+    header.scalingCount = transformations.size();
+    header.scalingsOffset = append(file, transformations.data(), transformations.size() * sizeof(SceneCacheTransformation));
+
+    transformations.resize(scene->rotations.size());
+    for (int i = 0; i < transformations.size(); i++)
+    {
+        Rotation *rotation = scene->rotations[i];
+        SceneCacheTransformation record = {rotation->rotationId, 0, {rotation->angle, rotation->ux, rotation->uy, rotation->uz}};
+        transformations[i] = record;
+    }
+    header.rotationCount = transformations.size();
+    header.rotationsOffset = append(file, transformations.data(), transformations.size() * sizeof(SceneCacheTransformation));
+
+    vector<SceneCacheMesh> meshes(scene->meshes.size());
+    vector<uint32_t> indices;
+    vector<int32_t> values;
+
+    for (int i = 0; i < meshes.size(); i++)
+    {
+        Mesh *mesh = scene->meshes[i];
+        SceneCacheMesh &record = meshes[i];
+
+        memset(&record, 0, sizeof(record));
+        record.meshId = mesh->meshId;
+        record.type = mesh->type;
+        record.transformationCount = mesh->transformationTypes.size();
+        record.triangleCount = mesh->triangles.size();
+        record.edgeCount = mesh->edges.size();
+        memcpy(record.modelingMatrix, mesh->modelingTransformation.values, sizeof(record.modelingMatrix));
+
+        record.transformationTypesOffset = append(file, mesh->transformationTypes.data(), record.transformationCount);
+        values.assign(mesh->transformationIds.begin(), mesh->transformationIds.end());
+        record.transformationIdsOffset = append(file, values.data(), values.size() * sizeof(int32_t));
+
+        indices.resize(mesh->triangles.size() * 3);
+        for (int j = 0; j < mesh->triangles.size(); j++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                int vertexId = mesh->triangles[j].vertexIds[k];
+                indices[j * 3 + k] = vertexId;
+
+                // a cache with such ids would be rejected when it is loaded
+                if (vertexId < 1 || vertexId > vertexCount)
+                    return false;
+
+                Vec3 *vertex = scene->vertices[vertexId - 1];
+                double position[3] = {vertex->x, vertex->y, vertex->z};
+                for (int c = 0; c < 3; c++)
+                {
+                    bool first = j == 0 && k == 0;
+                    if (first || position[c] < record.boundsMin[c])
+                        record.boundsMin[c] = position[c];
+                    if (first || position[c] > record.boundsMax[c])
+                        record.boundsMax[c] = position[c];
+                }
+            }
+        }
+        record.indicesOffset = append(file, indices.data(), indices.size() * sizeof(uint32_t));
+
+        values.resize(mesh->edges.size() * 4);
+        for (int j = 0; j < mesh->edges.size(); j++)
+        {
+            Edge &edge = mesh->edges[j];
+            values[j * 4] = edge.vertexIds[0];
+            values[j * 4 + 1] = edge.vertexIds[1];
+            values[j * 4 + 2] = edge.triangleIds[0];
+            values[j * 4 + 3] = edge.triangleIds[1];
+        }
+        record.edgesOffset = append(file, values.data(), values.size() * sizeof(int32_t));
+    }
+    header.meshCount = meshes.size();
+    header.meshesOffset = append(file, meshes.data(), meshes.size() * sizeof(SceneCacheMesh));
+
+    writeFileRecord(scene->sourceFile, header.sourceFile, strings);
+    vector<SceneCacheImportedFile> importedFiles(scene->importedFiles.size());
+    for (int i = 0; i < importedFiles.size(); i++)
+    {
+        writeFileRecord(scene->importedFiles[i], importedFiles[i], strings);
+    }
+    header.importedFileCount = importedFiles.size();
+    header.importedFilesOffset = append(file, importedFiles.data(), importedFiles.size() * sizeof(SceneCacheImportedFile));
+
+    header.stringsSize = strings.size();
+    header.stringsOffset = append(file, strings.data(), strings.size());
+    header.fileSize = file.size();
+    memcpy(&file[0], &header, sizeof(header));
+
+    string temporaryPath = string(path) + ".tmp";
+    ofstream stream(temporaryPath.c_str(), ios::binary);
+    stream.write(&file[0], file.size());
+    stream.close();
+
+    if (!stream)
+    {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return rename(temporaryPath.c_str(), path) == 0;
+}
+
+SceneCacheFile::SceneCacheFile()
+{
+    this->header = NULL;
+}
+
+const char *SceneCacheFile::getArray(uint64_t offset, uint64_t count, uint64_t size)
+{
+    if (offset > this->file.size || (size > 0 && count > (this->file.size - offset) / size))
+    {
+        return NULL;
+    }
+    return this->file.data + offset;
+}
+
+bool SceneCacheFile::open(const char *path)
+{
+    this->header = NULL;
+    if (!this->file.open(path) || this->file.size < sizeof(SceneCacheHeader))
+    {
+        return false;
+    }
+
+    const SceneCacheHeader *header = (const SceneCacheHeader *)this->file.data;
+    if (memcmp(header->magic, SCENE_CACHE_MAGIC, 8) != 0 || header->version != SCENE_CACHE_VERSION ||
+        header->byteOrder != SCENE_CACHE_BYTE_ORDER || header->fileSize != this->file.size)
+    {
+        return false;
+    }
+
+    this->cameras = (const SceneCacheCamera *)getArray(header->camerasOffset, header->cameraCount, sizeof(SceneCacheCamera));
+    this->translations = (const SceneCacheTransformation *)getArray(header->translationsOffset, header->translationCount, sizeof(SceneCacheTransformation));
+    this->scalings = (const SceneCacheTransformation *)getArray(header->scalingsOffset, header->scalingCount, sizeof(SceneCacheTransformation));
+    this->rotations = (const SceneCacheTransformation *)getArray(header->rotationsOffset, header->rotationCount, sizeof(SceneCacheTransformation));
+    this->meshes = (const SceneCacheMesh *)getArray(header->meshesOffset, header->meshCount, sizeof(SceneCacheMesh));
+    this->importedFiles = (const SceneCacheImportedFile *)getArray(header->importedFilesOffset, header->importedFileCount, sizeof(SceneCacheImportedFile));
+    this->strings = getArray(header->stringsOffset, header->stringsSize, 1);
+    bool valid = this->cameras != NULL && this->translations != NULL && this->scalings != NULL &&
+                 this->rotations != NULL && this->meshes != NULL && this->importedFiles != NULL && this->strings != NULL;
+
+    for (int k = 0; k < 3; k++)
+    {
+        this->positions[k] = (const double *)getArray(header->vertexOffsets[k], header->vertexCount, sizeof(double));
+        this->colors[k] = (const double *)getArray(header->colorOffsets[k], header->vertexCount, sizeof(double));
+        valid = valid && this->positions[k] != NULL && this->colors[k] != NULL;
+    }
+
+    if (valid)
+    {
+        this->header = header;
+    }
+    return valid;
+}
+
+bool SceneCacheFile::readSceneData(Scene *scene)
+{
+    const SceneCacheHeader *header = this->header;
+
+    scene->backgroundColor = Color(header->backgroundColor[0], header->backgroundColor[1], header->backgroundColor[2]);
+    scene->cullingEnabled = header->cullingEnabled != 0;
+
+    for (int i = 0; i < header->cameraCount; i++)
+    {
+        const SceneCacheCamera &record = this->cameras[i];
+        if ((uint64_t)record.outputNameOffset + record.outputNameLength > header->stringsSize)
+        {
+            return false;
+        }
+
+        scene->cameras.push_back(scene->arena.create<Camera>(record.cameraId, record.projectionType,
+                                            readVec3(record.position), readVec3(record.gaze),
+                                            readVec3(record.u), readVec3(record.v), readVec3(record.w),
+                                            record.left, record.right, record.bottom, record.top,
+                                            record.near, record.far, record.horRes, record.verRes,
+                                            string(this->strings + record.outputNameOffset, record.outputNameLength)));
+    }
+
+    for (int i = 0; i < header->translationCount; i++)
+    {
+        const double *values = this->translations[i].values;
+        scene->translations.push_back(scene->arena.create<Translation>(this->translations[i].id, values[0], values[1], values[2]));
+    }
+    for (int i = 0; i < header->scalingCount; i++)
+    {
+        const double *values = this->scalings[i].values;
+        scene->scalings.push_back(scene->arena.create<Scaling>(this->scalings[i].id, values[0], values[1], values[2]));
+    }
+    for (int i = 0; i < header->rotationCount; i++)
+    {
+        const double *values = this->rotations[i].values;
+        scene->rotations.push_back(scene->arena.create<Rotation>(this->rotations[i].id, values[0], values[1], values[2], values[3]));
+    }
+    return readSourceFile(scene->sourceFile) && readImportedFiles(scene->importedFiles);
+}
+
+bool SceneCacheFile::readFileRecord(const SceneCacheImportedFile &record, FileStatus &file)
+{
+    if ((uint64_t)record.pathOffset + record.pathLength > this->header->stringsSize)
+    {
+        return false;
+    }
+
+    file.path.assign(this->strings + record.pathOffset, record.pathLength);
+    file.modificationTime = record.modificationTime;
+    file.size = record.size;
+    return true;
+}
+
+bool SceneCacheFile::readSourceFile(FileStatus &file)
+{
+    return readFileRecord(this->header->sourceFile, file);
+}
+
+bool SceneCacheFile::readImportedFiles(vector<FileStatus> &files)
+{
+    files.resize(this->header->importedFileCount);
+    for (int i = 0; i < files.size(); i++)
+    {
+        if (!readFileRecord(this->importedFiles[i], files[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    Returns true when every vertex id of the mesh lies in [1, vertexCount] and every
+    triangle index of its edges in [0, triangleCount), so that the renderers can use
+    them without reading outside the arrays.
+*/
+static bool hasValidIds(const SceneCacheMesh &record, const uint32_t *indices, const int32_t *edges, uint32_t vertexCount)
+{
+    for (int64_t i = 0; i < (int64_t)record.triangleCount * 3; i++)
+    {
+        if (indices[i] < 1 || indices[i] > vertexCount)
+            return false;
+    }
+    for (int i = 0; i < record.edgeCount; i++)
+    {
+        const int32_t *edge = edges + (int64_t)i * 4;
+        if (edge[0] < 1 || (uint32_t)edge[0] > vertexCount || edge[1] < 1 || (uint32_t)edge[1] > vertexCount ||
+            edge[2] < 0 || edge[2] >= record.triangleCount ||
+            (edge[3] != NO_TRIANGLE && (edge[3] < 0 || edge[3] >= record.triangleCount)))
+            return false;
+    }
+    return true;
+}
+
+bool SceneCacheFile::readMeshHeader(int index, Mesh *mesh)
+{
+    const SceneCacheMesh &record = this->meshes[index];
+    const char *types = getArray(record.transformationTypesOffset, record.transformationCount, 1);
+    const int32_t *ids = (const int32_t *)getArray(record.transformationIdsOffset, record.transformationCount, sizeof(int32_t));
+    const uint32_t *indices = (const uint32_t *)getArray(record.indicesOffset, (uint64_t)record.triangleCount * 3, sizeof(uint32_t));
+    const int32_t *edges = (const int32_t *)getArray(record.edgesOffset, (uint64_t)record.edgeCount * 4, sizeof(int32_t));
+
+    if (record.transformationCount < 0 || record.triangleCount < 0 || record.edgeCount < 0 || types == NULL || ids == NULL ||
+        indices == NULL || edges == NULL || !hasValidIds(record, indices, edges, this->header->vertexCount))
+    {
+        return false;
+    }
+
+    mesh->meshId = record.meshId;
+    mesh->type = record.type;
+    mesh->numberOfTransformations = record.transformationCount;
+    mesh->numberOfTriangles = record.triangleCount;
+    mesh->transformationTypes.assign(types, types + record.transformationCount);
+    mesh->transformationIds.assign(ids, ids + record.transformationCount);
+    memcpy(mesh->modelingTransformation.values, record.modelingMatrix, sizeof(record.modelingMatrix));
+    return true;
+}
+
+bool readSceneCache(Scene *scene, const char *path)
+{
+    SceneCacheFile cache;
+    if (!cache.open(path) || !cache.readSceneData(scene))
+    {
+        return false;
+    }
+
+    // one array each, filled in a single pass
+    int vertexCount = cache.header->vertexCount;
+    Vec3 *vertices = scene->arena.createArray<Vec3>(vertexCount);
+    Color *colors = scene->arena.createArray<Color>(vertexCount);
+    scene->vertices.resize(vertexCount);
+    scene->colorsOfVertices.resize(vertexCount);
+    for (int i = 0; i < vertexCount; i++)
+    {
+        vertices[i] = Vec3(cache.positions[0][i], cache.positions[1][i], cache.positions[2][i], i + 1);
+        colors[i] = Color(cache.colors[0][i], cache.colors[1][i], cache.colors[2][i]);
+        scene->vertices[i] = &vertices[i];
+        scene->colorsOfVertices[i] = &colors[i];
+    }
+
+    for (int i = 0; i < cache.header->meshCount; i++)
+    {
+        Mesh *mesh = scene->arena.create<Mesh>();
+        scene->meshes.push_back(mesh);
+
+        if (!cache.readMeshHeader(i, mesh))
+        {
+            return false;
+        }
+
+        const SceneCacheMesh &record = cache.meshes[i];
+        const uint32_t *indices = (const uint32_t *)(cache.file.data + record.indicesOffset);
+        const int32_t *edges = (const int32_t *)(cache.file.data + record.edgesOffset);
+
+        mesh->triangles.resize(record.triangleCount);
+        for (int j = 0; j < record.triangleCount; j++)
+        {
+            mesh->triangles[j] = Triangle(indices[j * 3], indices[j * 3 + 1], indices[j * 3 + 2]);
+        }
+
+        mesh->edges.resize(record.edgeCount);
+        for (int j = 0; j < record.edgeCount; j++)
+        {
+            Edge &edge = mesh->edges[j];
+            edge.vertexIds[0] = edges[j * 4];
+            edge.vertexIds[1] = edges[j * 4 + 1];
+            edge.triangleIds[0] = edges[j * 4 + 2];
+            edge.triangleIds[1] = edges[j * 4 + 3];
+        }
+    }
+    return true;
+}
@@ -0,0 +1,146 @@
+#ifndef __SCENE_CACHE_H__
+#define __SCENE_CACHE_H__
+#define SCENE_CACHE_MAGIC "RSCACHE\x1a"
+#define SCENE_CACHE_VERSION 3
+#define SCENE_CACHE_BYTE_ORDER 0x01020304u
+#define SCENE_CACHE_ALIGNMENT 64
+#include <stdint.h>
+#include <vector>
+#include "FileStatus.h"
+#include "MappedFile.h"
+
+class Scene;
+class Mesh;
+
+/*
+    The XML file of the scene or an OBJ or PLY file a mesh was imported from, with its
+    modification time in nanoseconds and its size when it was read. The cache is stale
+    once either changes.
+*/
+class SceneCacheImportedFile
+{
+public:
+    uint32_t pathOffset, pathLength; // inside the strings block
+    int64_t modificationTime, size;
+};
+
+/*
+    Binary scene cache, a file laid out so that it can be used straight from a memory
+    mapping. It starts with a SceneCacheHeader, every array after it starts at a
+    multiple of SCENE_CACHE_ALIGNMENT bytes. Offsets count from the start of the file,
+    numbers are stored in the byte order of the machine that wrote the file.
+*/
+class SceneCacheHeader
+{
+public:
+    char magic[8];
+    uint32_t version, byteOrder;
+    double backgroundColor[3];
+    uint32_t cullingEnabled;
+    uint32_t cameraCount, vertexCount, translationCount, scalingCount, rotationCount, meshCount;
+    uint32_t stringsSize, importedFileCount;
+    uint64_t vertexOffsets[3]; // x, y and z arrays of vertexCount doubles each
+    uint64_t colorOffsets[3];  // r, g and b arrays of vertexCount doubles each
+    uint64_t camerasOffset, translationsOffset, scalingsOffset, rotationsOffset, meshesOffset, stringsOffset;
+    uint64_t importedFilesOffset;
+    SceneCacheImportedFile sourceFile; // the XML file the scene was parsed from
+    uint64_t fileSize;
+};
+
+/*
+    Camera with its basis already completed from the gaze and up vectors.
+*/
+class SceneCacheCamera
+{
+public:
+    int32_t cameraId, projectionType, horRes, verRes;
+    double position[3], gaze[3], u[3], v[3], w[3];
+    double left, right, bottom, top, near, far;
+    uint32_t outputNameOffset, outputNameLength; // inside the strings block
+};
+
+/*
+    Translation (tx, ty, tz, 0), scaling (sx, sy, sz, 0) or rotation (angle, ux, uy, uz).
+*/
+class SceneCacheTransformation
+{
+public:
+    int32_t id, padding;
+    double values[4];
+};
+
+class SceneCacheMesh
+{
+public:
+    int32_t meshId, type, transformationCount, triangleCount, edgeCount, padding;
+    uint64_t transformationTypesOffset; // transformationCount chars
+    uint64_t transformationIdsOffset;   // transformationCount int32s
+    uint64_t indicesOffset;             // triangleCount * 3 uint32 vertex ids, starting at 1
+    uint64_t edgesOffset;               // edgeCount * (2 vertex ids, 2 triangle indices) int32s
+    double modelingMatrix[16];          // the composed transformations, row major
+    double boundsMin[3], boundsMax[3];  // model space bounds of the vertices of the triangles
+};
+
+/*
+    A memory-mapped scene cache file. open checks the header and that the arrays it
+    points to lie inside the file, geometry is only read where it is used.
+*/
+class SceneCacheFile
+{
+public:
+    MappedFile file;
+    const SceneCacheHeader *header;
+    const SceneCacheCamera *cameras;
+    const SceneCacheTransformation *translations, *scalings, *rotations;
+    const SceneCacheMesh *meshes;
+    const SceneCacheImportedFile *importedFiles;
+    const char *strings;
+    const double *positions[3], *colors[3];
+
+    SceneCacheFile();
+
+    bool open(const char *path);
+
+    // returns the array of count elements of the given size at offset, NULL if it does not fit inside the file
+    const char *getArray(uint64_t offset, uint64_t count, uint64_t size);
+
+    // reads a file record, returns false if its path does not fit inside the strings block
+    bool readFileRecord(const SceneCacheImportedFile &record, FileStatus &file);
+
+    // reads everything but the vertices and mesh geometry into the scene
+    bool readSceneData(Scene *scene);
+
+    // reads the status of the XML file the scene was parsed from, false if its path does not fit inside the strings block
+    bool readSourceFile(FileStatus &file);
+
+    // reads the files the meshes were imported from, returns false if a path does not fit inside the strings block
+    bool readImportedFiles(std::vector<FileStatus> &files);
+
+    /*
+        Fills the mesh without its triangles and edges. Returns false if its arrays do not
+        fit inside the file or name a vertex or triangle that is not there, which reads
+        the whole index and edge arrays once.
+    */
+    bool readMeshHeader(int index, Mesh *mesh);
+};
+
+/*
+    Returns true when the file starts like a scene cache of this version.
+*/
+bool isSceneCacheFile(const char *path);
+
+/*
+    Writes the scene to path. The file is written next to it first and renamed,
+    so that a process loading the cache at the same time never sees half of it.
+    Returns false without writing when a triangle names a vertex that is not there.
+*/
+bool writeSceneCache(Scene *scene, const char *path);
+
+/*
+    Loads the scene from the memory-mapped cache file. Returns false when the file
+    is not a valid cache or a mesh names a vertex or triangle that is not there,
+    the scene may be partly filled then.
+*/
+bool readSceneCache(Scene *scene, const char *path);
+
+#endif
@@ -0,0 +1,17 @@
+#include "ScreenLine.h"
+
+ScreenLine::ScreenLine()
+{
+    this->x0 = this->y0 = this->x1 = this->y1 = 0;
+    this->xMajor = true;
+    this->steps = this->minorSteps = 0;
+    this->z = this->r = this->g = this->b = 0;
+    this->zStep = this->rStep = this->gStep = this->bStep = 0;
+    this->key = 0;
+}
+
+std::ostream &operator<<(std::ostream &os, const ScreenLine &l)
+{
+    os << "Screen line (" << l.x0 << ", " << l.y0 << ") to (" << l.x1 << ", " << l.y1 << ")";
+    return os;
+}
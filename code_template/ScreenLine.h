@@ -0,0 +1,26 @@
+#ifndef __SCREEN_LINE_H__
+#define __SCREEN_LINE_H__
+#include <iostream>
+#include "Region.h"
+
+/*
+    Clipped line in pixel coordinates, set up for Bresenham drawing.
+    The end points are ordered so that the walk goes along the increasing major axis,
+    depth and color at step k are start + k * step.
+*/
+class ScreenLine
+{
+public:
+    int x0, y0, x1, y1;
+    bool xMajor;
+    int steps, minorSteps;
+    double z, r, g, b;
+    double zStep, rStep, gStep, bStep;
+    Region bounds;
+    long long key; // submission order, used for depth ties when the frame buffer keeps keys
+
+    ScreenLine();
+    friend std::ostream &operator<<(std::ostream &os, const ScreenLine &l);
+};
+
+#endif
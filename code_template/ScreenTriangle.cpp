@@ -0,0 +1,15 @@
+#include "ScreenTriangle.h"
+
+ScreenTriangle::ScreenTriangle()
+{
+    this->f01_2 = 0;
+    this->f12_0 = 0;
+    this->f20_1 = 0;
+    this->key = 0;
+}
+
+std::ostream &operator<<(std::ostream &os, const ScreenTriangle &t)
+{
+    os << "Screen triangle " << t.vertices[0] << " " << t.vertices[1] << " " << t.vertices[2] << " in " << t.bounds;
+    return os;
+}
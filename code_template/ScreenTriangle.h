@@ -0,0 +1,24 @@
+#ifndef __SCREEN_TRIANGLE_H__
+#define __SCREEN_TRIANGLE_H__
+#include <iostream>
+#include "Vec4.h"
+#include "Color.h"
+#include "Region.h"
+
+/*
+    Triangle after viewport transformation, ready to be rasterized.
+*/
+class ScreenTriangle
+{
+public:
+    Vec4 vertices[3];
+    Color colors[3];
+    double f01_2, f12_0, f20_1; // edge functions evaluated at the opposite vertices
+    Region bounds;              // pixels covered by the bounding box, clamped to the image
+    long long key;              // submission order, used for depth ties when the frame buffer keeps keys
+
+    ScreenTriangle();
+    friend std::ostream &operator<<(std::ostream &os, const ScreenTriangle &t);
+};
+
+#endif
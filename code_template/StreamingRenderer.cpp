@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <thread>
+#include "StreamingRenderer.h"
+
+using namespace std;
+
+GeometryChunk::GeometryChunk()
+{
+    this->meshIndex = 0;
+    this->begin = 0;
+    this->end = 0;
+}
+
+GeometryChunk::GeometryChunk(int meshIndex, int begin, int end)
+{
+    this->meshIndex = meshIndex;
+    this->begin = begin;
+    this->end = end;
+}
+
+StreamingRenderer::StreamingRenderer(Scene *scene, int geometryThreads, int rasterThreads, bool deterministic)
+{
+    this->scene = scene;
+    this->geometryThreads = max(1, geometryThreads);
+    this->rasterThreads = max(1, rasterThreads);
+    this->deterministic = deterministic;
+    this->bandHeight = 1;
+
+    for (int i = 0; i < scene->meshes.size(); i++)
+    {
+        Mesh *mesh = scene->meshes[i];
+        int count = mesh->type == WIREFRAME_MESH ? mesh->edges.size() : mesh->triangles.size();
+
+        for (int begin = 0; begin < count; begin += STREAMING_CHUNK_SIZE)
+        {
+            this->chunks.push_back(GeometryChunk(i, begin, min(count, begin + STREAMING_CHUNK_SIZE)));
+        }
+    }
+
+    for (int i = 0; i < this->geometryThreads * this->rasterThreads; i++)
+    {
+        this->queues.push_back(new BatchQueue());
+    }
+    this->transformationMatrices.resize(scene->meshes.size());
+}
+
+StreamingRenderer::~StreamingRenderer()
+{
+    for (int i = 0; i < this->queues.size(); i++)
+    {
+        delete this->queues[i];
+    }
+}
+
+void StreamingRenderer::render(Camera *camera, FrameBuffer &frameBuffer)
+{
+    int width = camera->horRes;
+    int height = camera->verRes;
+
+    frameBuffer.keepKeys = this->deterministic;
+    frameBuffer.resize(width, height);
+    this->viewportTransformationMatrix = camera->getViewportTransformationMatrix();
+    this->bandHeight = (height + this->rasterThreads - 1) / this->rasterThreads;
+
+    for (int i = 0; i < this->scene->meshes.size(); i++)
+    {
+        this->transformationMatrices[i] = this->scene->getTransformationMatrix(this->scene->meshes[i], camera);
+    }
+    for (int i = 0; i < this->queues.size(); i++)
+    {
+        this->queues[i]->reset();
+    }
+
+    atomic<int> nextChunk(0);
+    vector<thread> threads;
+
+    for (int i = 0; i < this->rasterThreads; i++)
+    {
+        threads.push_back(thread(&StreamingRenderer::runRaster, this, i, ref(frameBuffer)));
+    }
+    for (int i = 0; i < this->geometryThreads; i++)
+    {
+        threads.push_back(thread(&StreamingRenderer::runGeometry, this, i, ref(nextChunk), width, height));
+    }
+    for (int i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+}
+
+/*
+    The edge is culled only when culling is enabled and every triangle sharing it is back facing.
+    Facing is decided here instead of in a pass over the mesh, so that no thread waits for one.
+*/
+bool StreamingRenderer::isEdgeVisible(Mesh *mesh, Edge &edge, Matrix4 &transformationMatrix)
+{
+    if (!this->scene->cullingEnabled)
+        return true;
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (edge.triangleIds[i] == NO_TRIANGLE)
+            continue;
+
+        Triangle &triangle = mesh->triangles[edge.triangleIds[i]];
+        Vec4 transformed_vertex_0 = this->scene->getTransformedVertex(triangle.vertexIds[0], transformationMatrix);
+        Vec4 transformed_vertex_1 = this->scene->getTransformedVertex(triangle.vertexIds[1], transformationMatrix);
+        Vec4 transformed_vertex_2 = this->scene->getTransformedVertex(triangle.vertexIds[2], transformationMatrix);
+        if (!this->scene->isBackFacing(transformed_vertex_0, transformed_vertex_1, transformed_vertex_2))
+            return true;
+    }
+    return false;
+}
+
+/*
+    Returns the batch the geometry thread is filling for the raster thread, starting a new
+    one when there is none or when it holds the other kind of primitives.
+*/
+PrimitiveBatch *StreamingRenderer::batchFor(int geometryIndex, int rasterIndex, int meshType, vector<PrimitiveBatch *> &openBatches)
+{
+    PrimitiveBatch *batch = openBatches[rasterIndex];
+
+    if (batch != NULL && batch->meshType != meshType)
+    {
+        flush(geometryIndex, rasterIndex, openBatches);
+        batch = NULL;
+    }
+    if (batch == NULL)
+    {
+        batch = this->queues[geometryIndex * this->rasterThreads + rasterIndex]->beginPush();
+        batch->meshType = meshType;
+        openBatches[rasterIndex] = batch;
+    }
+    return batch;
+}
+
+void StreamingRenderer::flush(int geometryIndex, int rasterIndex, vector<PrimitiveBatch *> &openBatches)
+{
+    if (openBatches[rasterIndex] != NULL)
+    {
+        this->queues[geometryIndex * this->rasterThreads + rasterIndex]->endPush();
+        openBatches[rasterIndex] = NULL;
+    }
+}
+
+/*
+    Clips and sets up the lines collected in the batch and passes them to the raster threads.
+*/
+void StreamingRenderer::pushLines(int geometryIndex, LineBatch &lineBatch, int width, int height, long long &key, vector<PrimitiveBatch *> &openBatches)
+{
+    ScreenLine screenLines[LINE_BATCH_SIZE];
+    int count = this->scene->setupLineBatch(lineBatch, this->viewportTransformationMatrix, width, height, screenLines);
+
+    for (int i = 0; i < count; i++)
+    {
+        screenLines[i].key = key++;
+        Region &bounds = screenLines[i].bounds;
+        for (int r = bounds.yMin / this->bandHeight; r <= bounds.yMax / this->bandHeight; r++)
+        {
+            PrimitiveBatch *batch = batchFor(geometryIndex, r, WIREFRAME_MESH, openBatches);
+            batch->lines[batch->count++] = screenLines[i];
+            if (batch->isFull())
+                flush(geometryIndex, r, openBatches);
+        }
+    }
+}
+
+void StreamingRenderer::runGeometry(int index, atomic<int> &nextChunk, int width, int height)
+{
+    Scene *scene = this->scene;
+    vector<PrimitiveBatch *> openBatches(this->rasterThreads, (PrimitiveBatch *)NULL);
+    LineBatch lineBatch;
+    ScreenTriangle screenTriangle;
+
+    for (int c = nextChunk++; c < (int)this->chunks.size(); c = nextChunk++)
+    {
+        GeometryChunk &chunk = this->chunks[c];
+        Mesh *mesh = scene->meshes[chunk.meshIndex];
+        Matrix4 &transformationMatrix = this->transformationMatrices[chunk.meshIndex];
+        long long key = (long long)c << 32;
+
+        if (mesh->type == WIREFRAME_MESH)
+        {
+            for (int i = chunk.begin; i < chunk.end; i++)
+            {
+                Edge &edge = mesh->edges[i];
+                if (!isEdgeVisible(mesh, edge, transformationMatrix))
+                    continue;
+
+                Vec4 transformed_vertex_0 = scene->getTransformedVertex(edge.vertexIds[0], transformationMatrix);
+                Vec4 transformed_vertex_1 = scene->getTransformedVertex(edge.vertexIds[1], transformationMatrix);
+                lineBatch.add(transformed_vertex_0, transformed_vertex_1, *scene->colorsOfVertices[edge.vertexIds[0] - 1], *scene->colorsOfVertices[edge.vertexIds[1] - 1]);
+
+                if (lineBatch.isFull())
+                    pushLines(index, lineBatch, width, height, key, openBatches);
+            }
+            pushLines(index, lineBatch, width, height, key, openBatches);
+        }
+        else
+        {
+            for (int i = chunk.begin; i < chunk.end; i++)
+            {
+                if (!scene->setupTriangle(mesh->triangles[i], transformationMatrix, this->viewportTransformationMatrix, width, height, screenTriangle))
+                    continue;
+
+                screenTriangle.key = key++;
+                Region &bounds = screenTriangle.bounds;
+                for (int r = bounds.yMin / this->bandHeight; r <= bounds.yMax / this->bandHeight; r++)
+                {
+                    PrimitiveBatch *batch = batchFor(index, r, SOLID_MESH, openBatches);
+                    batch->triangles[batch->count++] = screenTriangle;
+                    if (batch->isFull())
+                        flush(index, r, openBatches);
+                }
+            }
+        }
+    }
+
+    for (int r = 0; r < this->rasterThreads; r++)
+    {
+        flush(index, r, openBatches);
+        this->queues[index * this->rasterThreads + r]->close();
+    }
+}
+
+void StreamingRenderer::runRaster(int index, FrameBuffer &frameBuffer)
+{
+    Region band(0, index * this->bandHeight, frameBuffer.width - 1, min(frameBuffer.height, (index + 1) * this->bandHeight) - 1);
+
+    frameBuffer.clearDepth(band);
+
+    while (true)
+    {
+        bool drained = true;
+        bool idle = true;
+
+        for (int g = 0; g < this->geometryThreads; g++)
+        {
+            BatchQueue *queue = this->queues[g * this->rasterThreads + index];
+            // read before popping, a closed queue that is empty stays empty
+            bool closed = queue->isClosed();
+            PrimitiveBatch *batch = queue->beginPop();
+
+            if (batch == NULL)
+            {
+                drained = drained && closed;
+                continue;
+            }
+
+            for (int i = 0; i < batch->count; i++)
+            {
+                if (batch->meshType == WIREFRAME_MESH)
+                    this->scene->rasterizeLine(batch->lines[i], frameBuffer, band);
+                else
+                    this->scene->rasterizeTriangle(batch->triangles[i], frameBuffer, band);
+            }
+            queue->endPop();
+            idle = false;
+            drained = false;
+        }
+
+        if (drained)
+            break;
+        if (idle)
+            this_thread::yield();
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef __STREAMING_RENDERER_H__
+#define __STREAMING_RENDERER_H__
+#define STREAMING_CHUNK_SIZE 1024
+#include <vector>
+#include "Scene.h"
+#include "BatchQueue.h"
+
+/*
+    Range of triangles (solid meshes) or edges (wireframe meshes) of one mesh,
+    taken by one geometry thread.
+*/
+class GeometryChunk
+{
+public:
+    int meshIndex;
+    int begin, end;
+
+    GeometryChunk();
+    GeometryChunk(int meshIndex, int begin, int end);
+};
+
+/*
+    Pipelined version of Scene::forwardRenderingPipeline. Geometry threads take chunks
+    in mesh order and transform, cull, clip and set them up. The results go in batches
+    through a BatchQueue to each raster thread whose band of rows they touch, so the
+    geometry of later meshes overlaps with the rasterization of earlier ones and at most
+    BATCH_QUEUE_CAPACITY batches per queue exist at any time.
+    A raster thread draws whatever batch arrives first, so pixels where two primitives
+    have the same depth may differ from the serial image between runs. In deterministic
+    mode every primitive gets a key from its chunk index and its position in the chunk,
+    which follows the serial drawing order, and the frame buffer resolves such ties by
+    key. The image is then identical to the serial one.
+*/
+class StreamingRenderer
+{
+public:
+    Scene *scene;
+    int geometryThreads, rasterThreads;
+    bool deterministic;
+
+    StreamingRenderer(Scene *scene, int geometryThreads, int rasterThreads, bool deterministic);
+    ~StreamingRenderer();
+
+    void render(Camera *camera, FrameBuffer &frameBuffer);
+
+private:
+    std::vector<GeometryChunk> chunks;
+    std::vector<BatchQueue *> queues; // queue from geometry thread g to raster thread r is queues[g * rasterThreads + r]
+    std::vector<Matrix4> transformationMatrices;
+    Matrix4 viewportTransformationMatrix;
+    int bandHeight;
+
+    void runGeometry(int index, std::atomic<int> &nextChunk, int width, int height);
+    void runRaster(int index, FrameBuffer &frameBuffer);
+    bool isEdgeVisible(Mesh *mesh, Edge &edge, Matrix4 &transformationMatrix);
+    PrimitiveBatch *batchFor(int geometryIndex, int rasterIndex, int meshType, std::vector<PrimitiveBatch *> &openBatches);
+    void pushLines(int geometryIndex, LineBatch &lineBatch, int width, int height, long long &key, std::vector<PrimitiveBatch *> &openBatches);
+    void flush(int geometryIndex, int rasterIndex, std::vector<PrimitiveBatch *> &openBatches);
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "TextParser.h"
+
+using namespace std;
+
+// powers of ten that are exact in a double
+static const double exactPowersOfTen[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+const char *skipWhitespace(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+        p++;
+    return p;
+}
+
+const char *parseInt(const char *p, int &value)
+{
+    const char *start = p;
+    p = skipWhitespace(p);
+
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+')
+        p++;
+    if (!isDigit(*p))
+        return start;
+
+    long long result = 0;
+    while (isDigit(*p))
+    {
+        result = result * 10 + (*p - '0');
+        p++;
+    }
+    value = (int)(negative ? -result : result);
+    return p;
+}
+
+/*
+    Decimal numbers with at most 15 significant digits and a small exponent are
+    m * 10^e with m and 10^e exact doubles, so a single multiplication or division
+    rounds correctly (Clinger's fast path). Anything else, including inf and nan,
+    goes to strtod, which gives the same result as the sscanf calls this replaces.
+*/
+const char *parseDouble(const char *p, double &value)
+{
+    const char *start = p;
+    p = skipWhitespace(p);
+    const char *number = p;
+
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+')
+        p++;
+
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+
+    while (isDigit(*p))
+    {
+        if (digits > 0 || *p != '0')
+        {
+            if (digits < 19)
+                mantissa = mantissa * 10 + (*p - '0');
+            else
+                exponent++;
+            digits++;
+        }
+        any = true;
+        p++;
+    }
+    if (*p == '.')
+    {
+        p++;
+        while (isDigit(*p))
+        {
+            if (digits > 0 || *p != '0')
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    exponent--;
+                }
+                digits++;
+            }
+            else
+            {
+                exponent--;
+            }
+            any = true;
+            p++;
+        }
+    }
+
+    if (any && (*p == 'e' || *p == 'E'))
+    {
+        int e = 0;
+        const char *exponentEnd = parseInt(p + 1, e);
+        if (exponentEnd != p + 1 && !(p[1] == ' ' || p[1] == '\t' || p[1] == '\n' || p[1] == '\r'))
+        {
+            exponent += e;
+            p = exponentEnd;
+        }
+    }
+
+    if (any && digits <= 15 && exponent >= -22 && exponent <= 22)
+    {
+        double result = (double)mantissa;
+        result = exponent < 0 ? result / exactPowersOfTen[-exponent] : result * exactPowersOfTen[exponent];
+        value = negative ? -result : result;
+        return p;
+    }
+
+    char *end;
+    double result = strtod(number, &end);
+    if (end == number)
+        return start;
+    value = result;
+    return end;
+}
+
+static void parseFaceRows(const char *p, const char *end, vector<Triangle> &triangles)
+{
+    while (p < end)
+    {
+        const char *rowEnd = (const char *)memchr(p, '\n', end - p);
+        if (rowEnd == NULL)
+            rowEnd = end;
+
+        int v1, v2, v3;
+        const char *q = parseInt(p, v1);
+        const char *r = q != p ? parseInt(q, v2) : q;
+        const char *s = r != q ? parseInt(r, v3) : r;
+
+        // all three numbers have to come from this row
+        if (s != r && s <= rowEnd)
+            triangles.push_back(Triangle(v1, v2, v3));
+
+        p = rowEnd + 1;
+    }
+}
+
+ThreadPool &getParsingPool()
+{
+    static ThreadPool pool(thread::hardware_concurrency());
+    return pool;
+}
+
+void splitRows(const char *text, const char *end, int count, vector<const char *> &bounds)
+{
+    size_t length = end - text;
+
+    bounds.assign(1, text);
+    for (int i = 1; i < count; i++)
+    {
+        const char *p = max(bounds.back(), text + length * i / count);
+        const char *newline = (const char *)memchr(p, '\n', end - p);
+        bounds.push_back(newline != NULL ? newline + 1 : end);
+    }
+    bounds.push_back(end);
+}
+
+void parseFaces(const char *text, const char *end, vector<Triangle> &triangles)
+{
+    size_t length = end - text;
+
+    if (length < PARALLEL_FACES_MIN_LENGTH || getParsingPool().size() <= 1)
+    {
+        parseFaceRows(text, end, triangles);
+        return;
+    }
+
+    ThreadPool &pool = getParsingPool();
+    vector<const char *> bounds;
+    splitRows(text, end, pool.size(), bounds);
+
+    vector<vector<Triangle> > pieces(pool.size());
+    pool.parallelFor(pieces.size(), [&](int i)
+    {
+        parseFaceRows(bounds[i], bounds[i + 1], pieces[i]);
+    });
+    for (int i = 0; i < pieces.size(); i++)
+    {
+        triangles.insert(triangles.end(), pieces[i].begin(), pieces[i].end());
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef __TEXT_PARSER_H__
+#define __TEXT_PARSER_H__
+#define PARALLEL_FACES_MIN_LENGTH (4 << 20)
+#include <vector>
+#include "Triangle.h"
+#include "ThreadPool.h"
+
+/*
+    Number parsing in place on scene text, in the spirit of std::from_chars: no copies,
+    no locale. Each function skips leading whitespace and returns the position after the
+    number, or the position it started from when there is no number there, in which
+    case value is left unchanged.
+*/
+const char *skipWhitespace(const char *p);
+const char *parseInt(const char *p, int &value);
+const char *parseDouble(const char *p, double &value);
+
+/*
+    Pool of one thread per core shared by the parsers of large texts. It is created on
+    first use and kept until the process exits, so that loading a scene does not start
+    threads of its own.
+*/
+ThreadPool &getParsingPool();
+
+/*
+    Splits [text, end) into count pieces of about the same length, each starting after a
+    newline so that no row is split. bounds gets the count + 1 piece boundaries.
+*/
+void splitRows(const char *text, const char *end, int count, std::vector<const char *> &bounds);
+
+/*
+    Parses the "v1 v2 v3" rows in [text, end) into triangles, rows without three numbers
+    are skipped. The text has to be followed by a character that is not part of a number.
+    Text longer than PARALLEL_FACES_MIN_LENGTH is split on row boundaries and parsed
+    on the parsing pool.
+*/
+void parseFaces(const char *text, const char *end, std::vector<Triangle> &triangles);
+
+#endif
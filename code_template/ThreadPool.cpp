@@ -0,0 +1,328 @@
+#include "ThreadPool.h"
+
+using namespace std;
+
+/*
+    Shared state of one parallelFor call.
+*/
+class TaskGroup
+{
+public:
+    void (*function)(const void *, int);
+    const void *context;
+    vector<Task> tasks; // storage for the ranges split off while running, at most one per index
+    atomic<int> usedTasks;
+    atomic<int> remaining;
+};
+
+// pool and deque index of the running thread, set for pool workers only
+static thread_local ThreadPool *currentPool = NULL;
+static thread_local int currentIndex = 0;
+// pool whose externalMutex the running thread holds, set for threads outside of pools only
+static thread_local ThreadPool *lockedPool = NULL;
+
+TaskDeque::TaskDeque() : top(0), bottom(0)
+{
+    for (int i = 0; i < TASK_DEQUE_CAPACITY; i++)
+    {
+        tasks[i].store(NULL, memory_order_relaxed);
+    }
+}
+
+// only called by the owner, whose pushes are the only way the deque grows
+bool TaskDeque::isFull()
+{
+    return bottom.load(memory_order_relaxed) - top.load(memory_order_acquire) >= TASK_DEQUE_CAPACITY;
+}
+
+bool TaskDeque::isEmpty()
+{
+    return bottom.load(memory_order_acquire) <= top.load(memory_order_acquire);
+}
+
+void TaskDeque::push(Task *task)
+{
+    long b = bottom.load(memory_order_relaxed);
+
+    // release on the slot itself publishes the task's fields to a thief that reads it
+    tasks[b % TASK_DEQUE_CAPACITY].store(task, memory_order_release);
+    bottom.store(b + 1, memory_order_release);
+}
+
+Task *TaskDeque::pop()
+{
+    long b = bottom.load(memory_order_relaxed) - 1;
+    bottom.store(b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = top.load(memory_order_relaxed);
+
+    if (t > b)
+    {
+        // empty
+        bottom.store(b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Task *task = tasks[b % TASK_DEQUE_CAPACITY].load(memory_order_relaxed);
+    if (t == b)
+    {
+        // last task, race against thieves for it
+        if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        {
+            task = NULL;
+        }
+        bottom.store(b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+Task *TaskDeque::steal()
+{
+    long t = top.load(memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = bottom.load(memory_order_acquire);
+
+    if (t >= b)
+    {
+        return NULL;
+    }
+
+    Task *task = tasks[t % TASK_DEQUE_CAPACITY].load(memory_order_acquire);
+    if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+    {
+        return NULL;
+    }
+    return task;
+}
+
+ThreadPool::ThreadPool(int threadCount) : wakeEpoch(0), sleepingWorkers(0), stopping(false)
+{
+    if (threadCount < 1)
+    {
+        threadCount = 1;
+    }
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        this->deques.push_back(new TaskDeque());
+    }
+    this->groups.resize(threadCount);
+    this->depths.resize(threadCount, 0);
+    for (int i = 1; i < threadCount; i++)
+    {
+        this->workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(this->sleepMutex);
+        this->stopping = true;
+        this->wakeEpoch++;
+    }
+    this->wakeUp.notify_all();
+
+    for (int i = 0; i < this->workers.size(); i++)
+    {
+        this->workers[i].join();
+    }
+    for (int i = 0; i < this->deques.size(); i++)
+    {
+        delete this->deques[i];
+        for (int j = 0; j < this->groups[i].size(); j++)
+        {
+            delete this->groups[i][j];
+        }
+    }
+}
+
+int ThreadPool::size()
+{
+    return this->deques.size();
+}
+
+void ThreadPool::run(int count, void (*function)(const void *, int), const void *context)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // a thread outside of the pool takes the external deque, unless it already has it
+    // because this call comes from a body it runs
+    bool external = currentPool != this;
+    ThreadPool *previousLockedPool = lockedPool;
+    unique_lock<mutex> externalLock(this->externalMutex, defer_lock);
+    if (external && lockedPool != this)
+    {
+        externalLock.lock();
+        lockedPool = this;
+    }
+    int index = external ? 0 : currentIndex;
+    unsigned seed = index * 2654435761u + 1;
+
+    // only the thread holding deque index runs calls on it, one group per nesting depth
+    vector<TaskGroup *> &groups = this->groups[index];
+    int depth = this->depths[index]++;
+    if (depth == groups.size())
+    {
+        groups.push_back(new TaskGroup());
+    }
+
+    TaskGroup &group = *groups[depth];
+    group.function = function;
+    group.context = context;
+    if (group.tasks.size() < count)
+    {
+        group.tasks.resize(count);
+    }
+    group.usedTasks = 1;
+    group.remaining = count;
+
+    Task *root = &group.tasks[0];
+    root->group = &group;
+    root->begin = 0;
+    root->end = count;
+
+    execute(index, root);
+
+    // help with whatever is queued until every index of this call is done
+    while (group.remaining.load(memory_order_acquire) > 0)
+    {
+        Task *task = findTask(index, seed);
+
+        if (task != NULL)
+        {
+            execute(index, task);
+        }
+        else
+        {
+            this_thread::yield();
+        }
+    }
+    this->depths[index]--;
+    lockedPool = previousLockedPool;
+}
+
+/*
+    Runs a range on thread index. The upper half of the range is split off and pushed
+    to the thread's deque until a single index is left, idle threads steal the halves.
+*/
+void ThreadPool::execute(int index, Task *task)
+{
+    TaskGroup *group = task->group;
+    int begin = task->begin;
+    int end = task->end;
+    TaskDeque *deque = this->deques[index];
+
+    while (end - begin > 1 && !deque->isFull())
+    {
+        int middle = begin + (end - begin) / 2;
+        Task *upper = &group->tasks[group->usedTasks.fetch_add(1, memory_order_relaxed)];
+
+        upper->group = group;
+        upper->begin = middle;
+        upper->end = end;
+        deque->push(upper);
+        wakeWorkers(false);
+
+        end = middle;
+    }
+
+    for (int i = begin; i < end; i++)
+    {
+        group->function(group->context, i);
+    }
+
+    group->remaining.fetch_sub(end - begin, memory_order_release);
+}
+
+Task *ThreadPool::findTask(int index, unsigned &seed)
+{
+    Task *task = this->deques[index]->pop();
+    if (task != NULL)
+    {
+        return task;
+    }
+
+    int count = this->deques.size();
+    seed = seed * 1664525u + 1013904223u;
+    int start = (seed >> 8) % count;
+
+    for (int i = 0; i < count; i++)
+    {
+        int victim = (start + i) % count;
+
+        if (victim != index)
+        {
+            task = this->deques[victim]->steal();
+            if (task != NULL)
+            {
+                return task;
+            }
+        }
+    }
+    return NULL;
+}
+
+bool ThreadPool::hasQueuedTasks()
+{
+    for (int i = 0; i < this->deques.size(); i++)
+    {
+        if (!this->deques[i]->isEmpty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+    Wakes sleeping workers after new tasks are queued. Without always, the lock is only
+    taken when some worker announced that it is going to sleep.
+*/
+void ThreadPool::wakeWorkers(bool always)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (always || this->sleepingWorkers.load() > 0)
+    {
+        {
+            lock_guard<mutex> lock(this->sleepMutex);
+            this->wakeEpoch++;
+        }
+        this->wakeUp.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(int index)
+{
+    currentPool = this;
+    currentIndex = index;
+    unsigned seed = index * 2654435761u + 1;
+
+    while (!this->stopping.load())
+    {
+        Task *task = findTask(index, seed);
+
+        if (task != NULL)
+        {
+            execute(index, task);
+            continue;
+        }
+
+        // announce the sleep first, so that a push racing with the check below wakes us up
+        this->sleepingWorkers.fetch_add(1);
+        long seenEpoch = this->wakeEpoch.load();
+
+        if (!hasQueuedTasks())
+        {
+            unique_lock<mutex> lock(this->sleepMutex);
+            while (!this->stopping.load() && this->wakeEpoch.load() == seenEpoch)
+            {
+                this->wakeUp.wait(lock);
+            }
+        }
+        this->sleepingWorkers.fetch_sub(1);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+#define TASK_DEQUE_CAPACITY 1024
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+/*
+    A range [begin, end) of loop indices of a parallelFor call.
+*/
+class Task
+{
+public:
+    TaskGroup *group;
+    int begin, end;
+};
+
+/*
+    Chase-Lev work-stealing deque of fixed capacity. Only the owning thread pushes and pops
+    at the bottom, any other thread may steal from the top without taking a lock.
+*/
+class TaskDeque
+{
+public:
+    std::atomic<long> top, bottom;
+    std::atomic<Task *> tasks[TASK_DEQUE_CAPACITY];
+
+    TaskDeque();
+
+    bool isFull();
+    bool isEmpty();
+    void push(Task *task);
+    Task *pop();
+    Task *steal();
+};
+
+/*
+    Work-stealing thread pool. parallelFor splits its index range recursively, the halves
+    are pushed to the deque of the running thread and idle threads steal them, so a few
+    very large work items do not leave the other threads waiting.
+*/
+class ThreadPool
+{
+public:
+    ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    // number of threads taking part in a parallelFor, including the calling thread
+    int size();
+
+    /*
+        Calls body(i) for every i in [0, count) and returns when all calls are finished.
+        The calling thread works on the range too. It may be called from inside a body,
+        on a pool thread or on the outside thread running it, and from several threads
+        outside of the pool, which then take turns. The body is called through a function
+        pointer and the task storage of earlier calls is reused, so once that storage has
+        grown a call allocates nothing.
+    */
+    template <class Body>
+    void parallelFor(int count, const Body &body)
+    {
+        run(count, &callBody<Body>, &body);
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::vector<TaskDeque *> deques; // deques[0] is used by the thread outside of the pool
+    std::vector<std::vector<TaskGroup *> > groups; // per deque, the groups of its running calls by nesting depth, kept for reuse
+    std::vector<int> depths; // per deque, the number of its calls running
+    std::mutex externalMutex;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<long> wakeEpoch;
+    std::atomic<int> sleepingWorkers;
+    std::atomic<bool> stopping;
+
+    template <class Body>
+    static void callBody(const void *body, int i)
+    {
+        (*(const Body *)body)(i);
+    }
+
+    void run(int count, void (*function)(const void *, int), const void *context);
+    void workerLoop(int index);
+    void execute(int index, Task *task);
+    Task *findTask(int index, unsigned &seed);
+    bool hasQueuedTasks();
+    void wakeWorkers(bool always);
+};
+
+#endif
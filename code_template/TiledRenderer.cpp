@@ -0,0 +1,281 @@
+#include <algorithm>
+#include "TiledRenderer.h"
+
+using namespace std;
+
+PrimitiveChunk::PrimitiveChunk()
+{
+    this->meshIndex = 0;
+    this->begin = 0;
+    this->end = 0;
+}
+
+PrimitiveChunk::PrimitiveChunk(int meshIndex, int begin, int end)
+{
+    this->meshIndex = meshIndex;
+    this->begin = begin;
+    this->end = end;
+}
+
+TiledRenderer::TiledRenderer(Scene *scene, ThreadPool *pool)
+{
+    this->scene = scene;
+    this->pool = pool;
+    this->width = 0;
+    this->height = 0;
+    this->tileColumns = 0;
+    this->tileRows = 0;
+
+    // chunks are kept across frames so that their buffers are reused
+    for (int i = 0; i < scene->meshes.size(); i++)
+    {
+        Mesh *mesh = scene->meshes[i];
+        int count = mesh->type == WIREFRAME_MESH ? mesh->edges.size() : mesh->triangles.size();
+
+        for (int begin = 0; begin < count; begin += PRIMITIVES_PER_CHUNK)
+        {
+            this->chunks.push_back(PrimitiveChunk(i, begin, min(count, begin + PRIMITIVES_PER_CHUNK)));
+        }
+
+        if (mesh->hasCompactVertexRange())
+        {
+            int vertexCount = mesh->lastVertexId - mesh->firstVertexId + 1;
+
+            for (int begin = 0; begin < vertexCount; begin += PRIMITIVES_PER_CHUNK)
+            {
+                this->vertexChunks.push_back(PrimitiveChunk(i, begin, min(vertexCount, begin + PRIMITIVES_PER_CHUNK)));
+            }
+        }
+
+        if (mesh->type == WIREFRAME_MESH)
+        {
+            for (int begin = 0; begin < mesh->triangles.size(); begin += PRIMITIVES_PER_CHUNK)
+            {
+                this->facingChunks.push_back(PrimitiveChunk(i, begin, min((int)mesh->triangles.size(), begin + PRIMITIVES_PER_CHUNK)));
+            }
+        }
+    }
+
+    this->transformationMatrices.resize(scene->meshes.size());
+    this->transformedVertices.resize(scene->meshes.size());
+    this->frontFacing.resize(scene->meshes.size());
+}
+
+void TiledRenderer::render(Camera *camera, FrameBuffer &frameBuffer)
+{
+    frameBuffer.resize(camera->horRes, camera->verRes);
+    prepare(camera);
+
+    this->pool->parallelFor(this->tileColumns * this->tileRows, [&](int tile)
+    {
+        rasterizeTile(tile, frameBuffer);
+    });
+}
+
+void TiledRenderer::renderBands(Camera *camera, int bandRows, FrameBuffer &band, const function<void(FrameBuffer &)> &writeBand)
+{
+    prepare(camera);
+
+    int tileRowsPerBand = max(1, (bandRows + TILE_SIZE - 1) / TILE_SIZE);
+
+    for (int lastRow = this->tileRows - 1; lastRow >= 0; lastRow -= tileRowsPerBand)
+    {
+        int firstRow = max(0, lastRow - tileRowsPerBand + 1);
+        int bottom = firstRow * TILE_SIZE;
+        int top = min(this->height, (lastRow + 1) * TILE_SIZE) - 1;
+
+        band.resizeBand(this->width, bottom, top - bottom + 1);
+        band.clearColor(this->scene->backgroundColor);
+
+        this->pool->parallelFor((lastRow - firstRow + 1) * this->tileColumns, [&](int i)
+        {
+            rasterizeTile(firstRow * this->tileColumns + i, band);
+        });
+        writeBand(band);
+    }
+}
+
+/*
+    Transforms, sets up and bins every primitive of the scene for the camera.
+*/
+void TiledRenderer::prepare(Camera *camera)
+{
+    Scene *scene = this->scene;
+    int width = camera->horRes;
+    int height = camera->verRes;
+
+    this->width = width;
+    this->height = height;
+    this->viewportTransformationMatrix = camera->getViewportTransformationMatrix();
+    this->tileColumns = (width + TILE_SIZE - 1) / TILE_SIZE;
+    this->tileRows = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    this->pool->parallelFor(scene->meshes.size(), [&](int i)
+    {
+        Mesh *mesh = scene->meshes[i];
+
+        this->transformationMatrices[i] = scene->getTransformationMatrix(mesh, camera);
+        if (mesh->hasCompactVertexRange())
+        {
+            this->transformedVertices[i].resize(mesh->lastVertexId - mesh->firstVertexId + 1);
+        }
+        if (mesh->type == WIREFRAME_MESH && scene->cullingEnabled)
+        {
+            this->frontFacing[i].resize(mesh->triangles.size());
+        }
+    });
+
+    this->pool->parallelFor(this->vertexChunks.size(), [&](int i)
+    {
+        PrimitiveChunk &chunk = this->vertexChunks[i];
+
+        scene->transformVertices(scene->meshes[chunk.meshIndex], this->transformationMatrices[chunk.meshIndex],
+                                 chunk.begin, chunk.end, this->transformedVertices[chunk.meshIndex]);
+    });
+
+    if (scene->cullingEnabled)
+    {
+        this->pool->parallelFor(this->facingChunks.size(), [&](int i)
+        {
+            PrimitiveChunk &chunk = this->facingChunks[i];
+
+            scene->computeFrontFacing(scene->meshes[chunk.meshIndex], this->transformationMatrices[chunk.meshIndex],
+                                      this->transformedVertices[chunk.meshIndex], chunk.begin, chunk.end, this->frontFacing[chunk.meshIndex]);
+        });
+    }
+
+    this->pool->parallelFor(this->chunks.size(), [&](int i)
+    {
+        setupChunk(this->chunks[i], width, height);
+        binChunk(this->chunks[i]);
+    });
+}
+
+/*
+    Transforms, culls and clips the primitives of the chunk into screen space.
+*/
+void TiledRenderer::setupChunk(PrimitiveChunk &chunk, int width, int height)
+{
+    Scene *scene = this->scene;
+    Mesh *mesh = scene->meshes[chunk.meshIndex];
+    Matrix4 &transformationMatrix = this->transformationMatrices[chunk.meshIndex];
+    vector<Vec4> &transformedVertices = this->transformedVertices[chunk.meshIndex];
+
+    chunk.triangles.clear();
+    chunk.lines.clear();
+
+    if (mesh->type == WIREFRAME_MESH)
+    {
+        vector<char> &frontFacing = this->frontFacing[chunk.meshIndex];
+        LineBatch batch;
+        ScreenLine screenLines[LINE_BATCH_SIZE];
+
+        for (int i = chunk.begin; i < chunk.end; i++)
+        {
+            Edge &edge = mesh->edges[i];
+            if (!scene->isEdgeVisible(edge, frontFacing))
+                continue;
+
+            Vec4 transformed_vertex_0 = scene->getTransformedVertex(mesh, edge.vertexIds[0], transformationMatrix, transformedVertices);
+            Vec4 transformed_vertex_1 = scene->getTransformedVertex(mesh, edge.vertexIds[1], transformationMatrix, transformedVertices);
+            batch.add(transformed_vertex_0, transformed_vertex_1, *scene->colorsOfVertices[edge.vertexIds[0] - 1], *scene->colorsOfVertices[edge.vertexIds[1] - 1]);
+
+            if (batch.isFull())
+            {
+                int count = scene->setupLineBatch(batch, this->viewportTransformationMatrix, width, height, screenLines);
+                chunk.lines.insert(chunk.lines.end(), screenLines, screenLines + count);
+            }
+        }
+
+        int count = scene->setupLineBatch(batch, this->viewportTransformationMatrix, width, height, screenLines);
+        chunk.lines.insert(chunk.lines.end(), screenLines, screenLines + count);
+    }
+    else
+    {
+        ScreenTriangle screenTriangle;
+
+        for (int i = chunk.begin; i < chunk.end; i++)
+        {
+            if (scene->setupTriangle(mesh->triangles[i], mesh, transformationMatrix, transformedVertices, this->viewportTransformationMatrix, width, height, screenTriangle))
+            {
+                chunk.triangles.push_back(screenTriangle);
+            }
+        }
+    }
+}
+
+/*
+    Sorts the primitives of the chunk into per tile lists, keeping their order.
+*/
+void TiledRenderer::binChunk(PrimitiveChunk &chunk)
+{
+    int tileCount = this->tileColumns * this->tileRows;
+    bool lines = !chunk.lines.empty();
+    int count = lines ? chunk.lines.size() : chunk.triangles.size();
+
+    chunk.tileOffsets.assign(tileCount + 1, 0);
+
+    // count the primitives of every tile, then turn the counts into offsets
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            Region &bounds = lines ? chunk.lines[i].bounds : chunk.triangles[i].bounds;
+
+            for (int row = bounds.yMin / TILE_SIZE; row <= bounds.yMax / TILE_SIZE; row++)
+            {
+                for (int column = bounds.xMin / TILE_SIZE; column <= bounds.xMax / TILE_SIZE; column++)
+                {
+                    int tile = row * this->tileColumns + column;
+
+                    if (pass == 0)
+                        chunk.tileOffsets[tile + 1]++;
+                    else
+                        chunk.tileItems[chunk.tileOffsets[tile]++] = i;
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (int tile = 0; tile < tileCount; tile++)
+            {
+                chunk.tileOffsets[tile + 1] += chunk.tileOffsets[tile];
+            }
+            chunk.tileItems.resize(chunk.tileOffsets[tileCount]);
+        }
+        else
+        {
+            // filling moved every offset to the start of the next tile
+            for (int tile = tileCount; tile > 0; tile--)
+            {
+                chunk.tileOffsets[tile] = chunk.tileOffsets[tile - 1];
+            }
+            chunk.tileOffsets[0] = 0;
+        }
+    }
+}
+
+void TiledRenderer::rasterizeTile(int tile, FrameBuffer &frameBuffer)
+{
+    int column = tile % this->tileColumns;
+    int row = tile / this->tileColumns;
+    Region region(column * TILE_SIZE, row * TILE_SIZE,
+                  min(this->width, (column + 1) * TILE_SIZE) - 1,
+                  min(this->height, (row + 1) * TILE_SIZE) - 1);
+
+    frameBuffer.clearDepth(region);
+
+    for (int i = 0; i < this->chunks.size(); i++)
+    {
+        PrimitiveChunk &chunk = this->chunks[i];
+
+        for (int j = chunk.tileOffsets[tile]; j < chunk.tileOffsets[tile + 1]; j++)
+        {
+            if (chunk.lines.empty())
+                this->scene->rasterizeTriangle(chunk.triangles[chunk.tileItems[j]], frameBuffer, region);
+            else
+                this->scene->rasterizeLine(chunk.lines[chunk.tileItems[j]], frameBuffer, region);
+        }
+    }
+}
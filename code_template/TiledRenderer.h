@@ -0,0 +1,74 @@
+#ifndef __TILED_RENDERER_H__
+#define __TILED_RENDERER_H__
+#define TILE_SIZE 64
+#define PRIMITIVES_PER_CHUNK 4096
+#include <functional>
+#include <vector>
+#include "Scene.h"
+#include "ThreadPool.h"
+
+/*
+    A range of triangles (solid meshes) or edges (wireframe meshes) of one mesh,
+    set up and binned to tiles by a single task.
+*/
+class PrimitiveChunk
+{
+public:
+    int meshIndex;
+    int begin, end;
+    std::vector<ScreenTriangle> triangles;
+    std::vector<ScreenLine> lines;
+    std::vector<int> tileOffsets; // primitives of tile t are tileItems[tileOffsets[t]] .. tileItems[tileOffsets[t + 1] - 1]
+    std::vector<int> tileItems;   // indices into triangles or lines, in submission order
+
+    PrimitiveChunk();
+    PrimitiveChunk(int meshIndex, int begin, int end);
+};
+
+/*
+    Parallel version of Scene::forwardRenderingPipeline. Every stage is split into tasks
+    for the work-stealing pool:
+        - per mesh: transformation matrices
+        - per chunk of vertices: transformation, once per vertex of meshes with a compact vertex range
+        - per chunk of wireframe triangles: back face flags for edge culling
+        - per chunk of primitives: transformation, culling, clipping, setup and binning
+        - per tile: rasterization of the binned primitives
+    Tiles draw primitives in the order of Scene::meshes and their faces, so the image is
+    identical to the one of the serial pipeline.
+*/
+class TiledRenderer
+{
+public:
+    Scene *scene;
+    ThreadPool *pool;
+
+    TiledRenderer(Scene *scene, ThreadPool *pool);
+
+    void render(Camera *camera, FrameBuffer &frameBuffer);
+
+    /*
+        Renders the image in bands of whole tile rows, at least bandRows rows high, top band
+        first. Each band is drawn into band, which only holds the rows of one band, and handed
+        to writeBand before the next one is drawn, so the frame buffer memory depends on the
+        band height instead of the image height.
+    */
+    void renderBands(Camera *camera, int bandRows, FrameBuffer &band, const std::function<void(FrameBuffer &)> &writeBand);
+
+private:
+    std::vector<PrimitiveChunk> chunks;
+    std::vector<PrimitiveChunk> facingChunks;
+    std::vector<PrimitiveChunk> vertexChunks; // ranges of indices into transformedVertices
+    std::vector<Matrix4> transformationMatrices;
+    std::vector<std::vector<Vec4> > transformedVertices; // empty for meshes transformed per primitive
+    std::vector<std::vector<char> > frontFacing;
+    Matrix4 viewportTransformationMatrix;
+    int width, height;
+    int tileColumns, tileRows;
+
+    void prepare(Camera *camera);
+    void setupChunk(PrimitiveChunk &chunk, int width, int height);
+    void binChunk(PrimitiveChunk &chunk);
+    void rasterizeTile(int tile, FrameBuffer &frameBuffer);
+};
+
+#endif
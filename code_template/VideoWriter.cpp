@@ -0,0 +1,186 @@
+#include <cstring>
+#include <algorithm>
+#include "VideoWriter.h"
+
+using namespace std;
+
+#define Y4M_FRAME_HEADER "FRAME\n"
+
+/*
+    BT.601 limited range in 8-bit fixed point. The chroma ones take the sums of
+    the 2x2 pixels they cover, so they shift by two more bits.
+*/
+static inline unsigned char lumaOf(int r, int g, int b)
+{
+    return (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline unsigned char blueDifferenceOf(int r, int g, int b)
+{
+    return (unsigned char)(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+}
+
+static inline unsigned char redDifferenceOf(int r, int g, int b)
+{
+    return (unsigned char)(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+}
+
+VideoWriter::VideoWriter()
+{
+    this->format = VIDEO_Y4M;
+    this->framesPerSecond = 25;
+    this->width = 0;
+    this->height = 0;
+    this->frameCount = 0;
+    this->out = NULL;
+}
+
+bool VideoWriter::open(const char *path, int format, int framesPerSecond)
+{
+    this->format = format;
+    this->framesPerSecond = framesPerSecond;
+    this->frameCount = 0;
+
+    if (strcmp(path, "-") == 0)
+    {
+        this->out = &cout;
+        return true;
+    }
+
+    this->file.open(path, ios::binary);
+    if (!this->file)
+    {
+        cerr << "Could not open the video output " << path << endl;
+        return false;
+    }
+    this->out = &this->file;
+    return true;
+}
+
+/*
+    Converts the quantized frame in rgb to planar Y, U and V after the frame header.
+    The pixels are split into red, green and blue planes first, so that the lane loops
+    below read contiguous bytes and the compiler turns them into SIMD multiplies and
+    shifts, YUV_LANES pixels at a time. The chroma of an odd last column or row
+    repeats its pixels.
+*/
+void VideoWriter::convertToYUV()
+{
+    int width = this->width;
+    int height = this->height;
+    int count = width * height;
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    int headerLength = strlen(Y4M_FRAME_HEADER);
+
+    this->planes.resize(3 * count);
+    unsigned char *red = &this->planes[0];
+    unsigned char *green = red + count;
+    unsigned char *blue = green + count;
+    for (int i = 0; i < count; i++)
+    {
+        red[i] = this->rgb[3 * i];
+        green[i] = this->rgb[3 * i + 1];
+        blue[i] = this->rgb[3 * i + 2];
+    }
+
+    this->frame.resize(headerLength + count + 2 * chromaWidth * chromaHeight);
+    memcpy(&this->frame[0], Y4M_FRAME_HEADER, headerLength);
+    unsigned char *lumaPlane = &this->frame[headerLength];
+    unsigned char *uPlane = lumaPlane + count;
+    unsigned char *vPlane = uPlane + chromaWidth * chromaHeight;
+
+    int i = 0;
+    for (; i + YUV_LANES <= count; i += YUV_LANES)
+    {
+        unsigned char lanes[YUV_LANES];
+
+        for (int j = 0; j < YUV_LANES; j++)
+        {
+            lanes[j] = lumaOf(red[i + j], green[i + j], blue[i + j]);
+        }
+        for (int j = 0; j < YUV_LANES; j++)
+        {
+            lumaPlane[i + j] = lanes[j];
+        }
+    }
+    for (; i < count; i++)
+    {
+        lumaPlane[i] = lumaOf(red[i], green[i], blue[i]);
+    }
+
+    for (int y = 0; y < chromaHeight; y++)
+    {
+        int top = 2 * y * width;
+        int bottom = min(2 * y + 1, height - 1) * width;
+        const unsigned char *r0 = red + top, *g0 = green + top, *b0 = blue + top;
+        const unsigned char *r1 = red + bottom, *g1 = green + bottom, *b1 = blue + bottom;
+        unsigned char *u = uPlane + y * chromaWidth;
+        unsigned char *v = vPlane + y * chromaWidth;
+        int x = 0;
+
+        for (; x + YUV_LANES <= width / 2; x += YUV_LANES)
+        {
+            unsigned char uLanes[YUV_LANES], vLanes[YUV_LANES];
+
+            for (int j = 0; j < YUV_LANES; j++)
+            {
+                int k = 2 * (x + j);
+                int r = r0[k] + r0[k + 1] + r1[k] + r1[k + 1];
+                int g = g0[k] + g0[k + 1] + g1[k] + g1[k + 1];
+                int b = b0[k] + b0[k + 1] + b1[k] + b1[k + 1];
+                uLanes[j] = blueDifferenceOf(r, g, b);
+                vLanes[j] = redDifferenceOf(r, g, b);
+            }
+            for (int j = 0; j < YUV_LANES; j++)
+            {
+                u[x + j] = uLanes[j];
+                v[x + j] = vLanes[j];
+            }
+        }
+        for (; x < chromaWidth; x++)
+        {
+            int k = 2 * x;
+            int next = k + 1 < width ? k + 1 : k;
+            int r = r0[k] + r0[next] + r1[k] + r1[next];
+            int g = g0[k] + g0[next] + g1[k] + g1[next];
+            int b = b0[k] + b0[next] + b1[k] + b1[next];
+            u[x] = blueDifferenceOf(r, g, b);
+            v[x] = redDifferenceOf(r, g, b);
+        }
+    }
+}
+
+void VideoWriter::writeFrame(Camera *camera, FrameBuffer &frameBuffer)
+{
+    if (this->frameCount == 0)
+    {
+        this->width = frameBuffer.width;
+        this->height = frameBuffer.height;
+        if (this->format == VIDEO_Y4M)
+        {
+            *this->out << "YUV4MPEG2 W" << this->width << " H" << this->height << " F" << this->framesPerSecond
+                       << ":1 Ip A1:1 C420jpeg XYSCSS=420JPEG\n";
+        }
+    }
+    else if (frameBuffer.width != this->width || frameBuffer.height != this->height)
+    {
+        cerr << "Skipping camera " << camera->cameraId << ": its " << frameBuffer.width << "x" << frameBuffer.height
+             << " image does not fit the " << this->width << "x" << this->height << " video" << endl;
+        return;
+    }
+
+    this->rgb.resize(this->width * this->height * 3);
+    frameBuffer.quantize(&this->rgb[0]);
+
+    if (this->format == VIDEO_Y4M)
+    {
+        convertToYUV();
+        this->out->write((const char *)&this->frame[0], this->frame.size());
+    }
+    else
+    {
+        this->out->write((const char *)&this->rgb[0], this->rgb.size());
+    }
+    this->frameCount++;
+}
@@ -0,0 +1,45 @@
+#ifndef __VIDEO_WRITER_H__
+#define __VIDEO_WRITER_H__
+#define VIDEO_Y4M 0
+#define VIDEO_RGB 1
+#define YUV_LANES 16
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Camera.h"
+#include "FrameBuffer.h"
+
+/*
+    Writes every image of a run as a frame of one uncompressed video stream instead of
+    one file per camera, so that it can be piped straight into an encoder:
+        VIDEO_Y4M   YUV4MPEG2 with 4:2:0 chroma (C420jpeg), BT.601 limited range
+        VIDEO_RGB   raw 8-bit RGB frames, top row first, the pixels of a P6 file
+    The path "-" writes to the standard output, a file is closed with the writer.
+    The first frame sets the size of the stream, frames of another size are reported
+    and skipped. Frames are written in the order they are passed, one write per frame.
+*/
+class VideoWriter
+{
+public:
+    int format; // VIDEO_Y4M or VIDEO_RGB
+    int framesPerSecond;
+    int width, height;
+    int frameCount;
+
+    VideoWriter();
+
+    // prints what is wrong and returns false when the output cannot be opened
+    bool open(const char *path, int format, int framesPerSecond);
+    void writeFrame(Camera *camera, FrameBuffer &frameBuffer);
+
+private:
+    std::ofstream file;
+    std::ostream *out;
+    std::vector<unsigned char> rgb;    // the quantized frame
+    std::vector<unsigned char> planes; // its red, green and blue planes
+    std::vector<unsigned char> frame;  // what is written for it
+
+    void convertToYUV();
+};
+
+#endif
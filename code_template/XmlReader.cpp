@@ -0,0 +1,157 @@
+#include <cstring>
+#include "XmlReader.h"
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+XmlReader::XmlReader(const char *begin, const char *end)
+{
+    this->p = begin;
+    this->end = end;
+    this->type = XML_END;
+    this->name = this->nameEnd = NULL;
+    this->text = this->textEnd = NULL;
+    this->attributes = this->attributesEnd = NULL;
+    this->selfClosing = false;
+}
+
+// position of pattern in [from, end), or NULL
+const char *XmlReader::find(const char *from, const char *pattern)
+{
+    size_t length = strlen(pattern);
+
+    while (from + length <= this->end)
+    {
+        const char *candidate = (const char *)memchr(from, pattern[0], this->end - from);
+        if (candidate == NULL || candidate + length > this->end)
+            return NULL;
+        if (memcmp(candidate, pattern, length) == 0)
+            return candidate;
+        from = candidate + 1;
+    }
+    return NULL;
+}
+
+int XmlReader::next()
+{
+    while (this->p < this->end)
+    {
+        if (*this->p != '<')
+        {
+            const char *q = (const char *)memchr(this->p, '<', this->end - this->p);
+            if (q == NULL)
+                q = this->end;
+            if (memchr(this->p, '&', q - this->p) != NULL)
+                return this->type = XML_UNSUPPORTED;
+
+            this->text = this->p;
+            this->textEnd = q;
+            this->p = q;
+            return this->type = XML_TEXT;
+        }
+
+        if (this->p + 1 >= this->end)
+            return this->type = XML_UNSUPPORTED;
+
+        if (this->p[1] == '?' || (this->end - this->p >= 4 && memcmp(this->p, "<!--", 4) == 0))
+        {
+            // declaration or comment, skipped
+            const char *close = this->p[1] == '?' ? find(this->p + 2, "?>") : find(this->p + 4, "-->");
+            if (close == NULL)
+                return this->type = XML_UNSUPPORTED;
+            this->p = close + (this->p[1] == '?' ? 2 : 3);
+            continue;
+        }
+        if (this->p[1] == '!')
+            return this->type = XML_UNSUPPORTED;
+
+        bool isEndTag = this->p[1] == '/';
+        const char *q = this->p + (isEndTag ? 2 : 1);
+        this->name = q;
+        while (q < this->end && !isSpace(*q) && *q != '/' && *q != '>')
+            q++;
+        this->nameEnd = q;
+        this->attributes = q;
+
+        // the tag ends at the first '>' outside of quotes
+        char quote = 0;
+        while (q < this->end && (quote != 0 || *q != '>'))
+        {
+            if (quote != 0 && *q == quote)
+                quote = 0;
+            else if (quote == 0 && (*q == '"' || *q == '\''))
+                quote = *q;
+            q++;
+        }
+        if (q >= this->end || this->name == this->nameEnd)
+            return this->type = XML_UNSUPPORTED;
+
+        this->selfClosing = !isEndTag && q[-1] == '/';
+        this->attributesEnd = this->selfClosing ? q - 1 : q;
+        this->p = q + 1;
+
+        if (memchr(this->attributes, '&', this->attributesEnd - this->attributes) != NULL)
+            return this->type = XML_UNSUPPORTED;
+        return this->type = isEndTag ? XML_END_TAG : XML_START_TAG;
+    }
+    return this->type = XML_END;
+}
+
+bool XmlReader::isName(const char *tagName)
+{
+    size_t length = strlen(tagName);
+    return (size_t)(this->nameEnd - this->name) == length && memcmp(this->name, tagName, length) == 0;
+}
+
+bool XmlReader::getAttribute(const char *attributeName, const char *&value, const char *&valueEnd)
+{
+    size_t length = strlen(attributeName);
+    const char *q = this->attributes;
+
+    while (q < this->attributesEnd)
+    {
+        while (q < this->attributesEnd && isSpace(*q))
+            q++;
+        const char *attributeStart = q;
+        while (q < this->attributesEnd && *q != '=' && !isSpace(*q))
+            q++;
+        const char *attributeEnd = q;
+        while (q < this->attributesEnd && (isSpace(*q) || *q == '='))
+            q++;
+        if (q >= this->attributesEnd || (*q != '"' && *q != '\''))
+            return false;
+
+        const char *close = (const char *)memchr(q + 1, *q, this->attributesEnd - q - 1);
+        if (close == NULL)
+            return false;
+
+        if ((size_t)(attributeEnd - attributeStart) == length && memcmp(attributeStart, attributeName, length) == 0)
+        {
+            value = q + 1;
+            valueEnd = close;
+            return true;
+        }
+        q = close + 1;
+    }
+    return false;
+}
+
+bool XmlReader::readText(const char *&value, const char *&valueEnd)
+{
+    // empty elements give an empty string, so that parsing stops right away
+    static const char empty[1] = {0};
+    value = valueEnd = empty;
+    if (this->selfClosing)
+        return true;
+
+    int token = next();
+    if (token == XML_TEXT)
+    {
+        value = this->text;
+        valueEnd = this->textEnd;
+        token = next();
+    }
+    return token == XML_END_TAG;
+}
@@ -0,0 +1,44 @@
+#ifndef __XML_READER_H__
+#define __XML_READER_H__
+#define XML_UNSUPPORTED -1
+#define XML_END 0
+#define XML_START_TAG 1
+#define XML_END_TAG 2
+#define XML_TEXT 3
+
+/*
+    Pull parser over XML text in memory, for the subset of XML the scene files use:
+    elements, attributes, text, comments and the XML declaration. Tokens point into the
+    text, nothing is copied. DOCTYPE, CDATA and entity references are reported as
+    XML_UNSUPPORTED so that the caller can fall back to a complete XML parser.
+*/
+class XmlReader
+{
+public:
+    int type;
+    const char *name, *nameEnd;     // tag name of XML_START_TAG and XML_END_TAG
+    const char *text, *textEnd;     // content of XML_TEXT
+    bool selfClosing;               // XML_START_TAG written as <name ... />
+
+    XmlReader(const char *begin, const char *end);
+
+    // moves to the next token and returns its type
+    int next();
+    bool isName(const char *tagName);
+    // finds the attribute of the current start tag, value is not terminated
+    bool getAttribute(const char *attributeName, const char *&value, const char *&valueEnd);
+    /*
+        Returns the text of the element whose start tag was just read and moves past its
+        end tag. Fails on child elements. The text is followed by '<' or a null character,
+        so the number parsers of TextParser stop at its end.
+    */
+    bool readText(const char *&value, const char *&valueEnd);
+
+private:
+    const char *p, *end;
+    const char *attributes, *attributesEnd;
+
+    const char *find(const char *from, const char *pattern);
+};
+
+#endif
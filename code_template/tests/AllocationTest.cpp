@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <fstream>
+#include <new>
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "TiledRenderer.h"
+
+using namespace std;
+
+/*
+    Renders a camera twice with Scene::forwardRenderingPipeline and twice with a
+    TiledRenderer on a thread pool, and checks that the second render of each, with the
+    frame buffer and scratch space already grown, makes no heap allocations. Every
+    operator new of the process goes through the counter below.
+*/
+
+static atomic<long> allocationCount(0);
+
+void *operator new(size_t size)
+{
+    allocationCount++;
+    void *pointer = malloc(size > 0 ? size : 1);
+    if (pointer == NULL)
+        throw bad_alloc();
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+// a solid cube and a wireframe cube next to it, culling enabled
+static const char *sceneXML =
+    "<Scene>\n"
+    "<BackgroundColor>20 20 40</BackgroundColor>\n"
+    "<Culling>enabled</Culling>\n"
+    "<Cameras>\n"
+    "<Camera id=\"1\" type=\"perspective\">\n"
+    "<Position>3 2 6</Position>\n"
+    "<Gaze>-3 -2 -6</Gaze>\n"
+    "<Up>0 1 0</Up>\n"
+    "<ImagePlane>-1 1 -1 1 2 100 160 120</ImagePlane>\n"
+    "<OutputName>allocation_test.ppm</OutputName>\n"
+    "</Camera>\n"
+    "</Cameras>\n"
+    "<Vertices>\n"
+    "<Vertex id=\"1\" position=\"-1 -1 1\" color=\"255 0 0\" />\n"
+    "<Vertex id=\"2\" position=\"1 -1 1\" color=\"0 255 0\" />\n"
+    "<Vertex id=\"3\" position=\"1 1 1\" color=\"0 0 255\" />\n"
+    "<Vertex id=\"4\" position=\"-1 1 1\" color=\"255 255 0\" />\n"
+    "<Vertex id=\"5\" position=\"-1 -1 -1\" color=\"255 0 255\" />\n"
+    "<Vertex id=\"6\" position=\"1 -1 -1\" color=\"0 255 255\" />\n"
+    "<Vertex id=\"7\" position=\"1 1 -1\" color=\"255 255 255\" />\n"
+    "<Vertex id=\"8\" position=\"-1 1 -1\" color=\"127 127 127\" />\n"
+    "</Vertices>\n"
+    "<Translations>\n"
+    "<Translation id=\"1\" value=\"-1.5 0 0\" />\n"
+    "<Translation id=\"2\" value=\"1.5 0 0\" />\n"
+    "</Translations>\n"
+    "<Scalings>\n"
+    "<Scaling id=\"1\" value=\"0.7 0.7 0.7\" />\n"
+    "</Scalings>\n"
+    "<Rotations>\n"
+    "<Rotation id=\"1\" value=\"30 0 1 0\" />\n"
+    "</Rotations>\n"
+    "<Meshes>\n"
+    "<Mesh id=\"1\" type=\"solid\">\n"
+    "<Transformations>\n"
+    "<Transformation>t 1</Transformation>\n"
+    "<Transformation>s 1</Transformation>\n"
+    "<Transformation>r 1</Transformation>\n"
+    "</Transformations>\n"
+    "<Faces>\n"
+    "1 2 3\n1 3 4\n6 5 8\n6 8 7\n5 1 4\n5 4 8\n2 6 7\n2 7 3\n4 3 7\n4 7 8\n5 6 2\n5 2 1\n"
+    "</Faces>\n"
+    "</Mesh>\n"
+    "<Mesh id=\"2\" type=\"wireframe\">\n"
+    "<Transformations>\n"
+    "<Transformation>t 2</Transformation>\n"
+    "<Transformation>s 1</Transformation>\n"
+    "</Transformations>\n"
+    "<Faces>\n"
+    "1 2 3\n1 3 4\n6 5 8\n6 8 7\n5 1 4\n5 4 8\n2 6 7\n2 7 3\n4 3 7\n4 7 8\n5 6 2\n5 2 1\n"
+    "</Faces>\n"
+    "</Mesh>\n"
+    "</Meshes>\n"
+    "</Scene>\n";
+
+int main()
+{
+    const char *path = "allocation_test.xml";
+    {
+        ofstream file(path);
+        file << sceneXML;
+    }
+
+    Scene scene(path);
+    remove(path);
+    if (scene.cameras.size() != 1 || scene.meshes.size() != 2)
+    {
+        printf("FAIL: could not load the test scene\n");
+        return 1;
+    }
+
+    Camera *camera = scene.cameras[0];
+    scene.initializeImage(camera);
+    scene.forwardRenderingPipeline(camera);
+
+    long before = allocationCount;
+    scene.initializeImage(camera);
+    scene.forwardRenderingPipeline(camera);
+    long allocations = allocationCount - before;
+
+    if (allocations != 0)
+    {
+        printf("FAIL: the second serial render made %ld allocations\n", allocations);
+        return 1;
+    }
+    printf("PASS: the second serial render made no allocations\n");
+
+    ThreadPool pool(2);
+    TiledRenderer renderer(&scene, &pool);
+    FrameBuffer frameBuffer;
+    renderer.render(camera, frameBuffer);
+
+    before = allocationCount;
+    renderer.render(camera, frameBuffer);
+    allocations = allocationCount - before;
+
+    if (allocations != 0)
+    {
+        printf("FAIL: the second tiled render made %ld allocations\n", allocations);
+        return 1;
+    }
+    printf("PASS: the second tiled render made no allocations\n");
+    return 0;
+}